@@ -32,6 +32,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/attitude-change.cc \
     $(CRAWL_PATH)/beam.cc \
     $(CRAWL_PATH)/behold.cc \
+    $(CRAWL_PATH)/bench.cc \
     $(CRAWL_PATH)/bitary.cc \
     $(CRAWL_PATH)/branch.cc \
     $(CRAWL_PATH)/butcher.cc \
@@ -70,6 +71,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/dgn-proclayouts.cc \
     $(CRAWL_PATH)/dgn-shoals.cc \
     $(CRAWL_PATH)/dgn-swamp.cc \
+    $(CRAWL_PATH)/dgn-zones.cc \
     $(CRAWL_PATH)/dgn-event.cc \
     $(CRAWL_PATH)/directn.cc \
     $(CRAWL_PATH)/dlua.cc \
@@ -112,6 +114,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/items.cc \
     $(CRAWL_PATH)/jobs.cc \
     $(CRAWL_PATH)/json.cc \
+    $(CRAWL_PATH)/keylog.cc \
     $(CRAWL_PATH)/kills.cc \
     $(CRAWL_PATH)/l-colour.cc \
     $(CRAWL_PATH)/l-crawl.cc \
@@ -120,6 +123,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/l-dgnbld.cc \
     $(CRAWL_PATH)/l-dgnevt.cc \
     $(CRAWL_PATH)/l-dgngrd.cc \
+    $(CRAWL_PATH)/l-dgnhyper.cc \
     $(CRAWL_PATH)/l-dgnit.cc \
     $(CRAWL_PATH)/l-dgnlvl.cc \
     $(CRAWL_PATH)/l-dgnmon.cc \
@@ -157,6 +161,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/mapmark.cc \
     $(CRAWL_PATH)/maps.cc \
     $(CRAWL_PATH)/melee-attack.cc \
+    $(CRAWL_PATH)/memstats.cc \
     $(CRAWL_PATH)/menu.cc \
     $(CRAWL_PATH)/message-stream.cc \
     $(CRAWL_PATH)/message.cc \
@@ -200,6 +205,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/perlin.cc \
     $(CRAWL_PATH)/place-info.cc \
     $(CRAWL_PATH)/place.cc \
+    $(CRAWL_PATH)/pregen.cc \
     $(CRAWL_PATH)/playable.cc \
     $(CRAWL_PATH)/player-act.cc \
     $(CRAWL_PATH)/player-equip.cc \
@@ -208,6 +214,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/player.cc \
     $(CRAWL_PATH)/potion.cc \
     $(CRAWL_PATH)/prompt.cc \
+    $(CRAWL_PATH)/profiler.cc \
     $(CRAWL_PATH)/quiver.cc \
     $(CRAWL_PATH)/randbook.cc \
     $(CRAWL_PATH)/random.cc \
@@ -275,6 +282,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/wiz-mon.cc \
     $(CRAWL_PATH)/wiz-you.cc \
     $(CRAWL_PATH)/worley.cc \
+    $(CRAWL_PATH)/xlog-query.cc \
     $(CRAWL_PATH)/xom.cc \
     $(CRAWL_PATH)/tilepick.cc \
     $(CRAWL_PATH)/tileview.cc \
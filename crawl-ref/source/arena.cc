@@ -141,6 +141,11 @@ namespace arena
     static FILE *file = nullptr;
     static level_id place(BRANCH_DEPTHS, 1);
 
+    // Set when running without a display (for -bench); fights then also
+    // end in a tie after turn_limit turns, if that is positive.
+    static bool headless = false;
+    static int turn_limit = 0;
+
     static void adjust_spells(monster* mons, bool no_summons, bool no_animate)
     {
         monster_spells &spells(mons->spells);
@@ -438,6 +443,9 @@ namespace arena
 
     static void show_fight_banner(bool after_fight = false)
     {
+        if (headless)
+            return;
+
         int line = 1;
 
         cgotoxy(1, line++, GOTO_STAT);
@@ -566,6 +574,9 @@ namespace arena
     // Returns true as long as at least one member of each faction is alive.
     static bool fight_is_on()
     {
+        if (turn_limit > 0 && turns >= turn_limit)
+            return false;
+
         if (faction_a.active_members > 0 && faction_b.active_members > 0)
         {
             if (faction_a.won || faction_b.won)
@@ -790,7 +801,7 @@ namespace arena
             cursor_control coff(false);
             while (fight_is_on())
             {
-                if (kbhit())
+                if (!headless && kbhit())
                 {
                     const int ch = getchm();
                     handle_keypress(ch);
@@ -818,7 +829,8 @@ namespace arena
                 do_respawn(faction_a);
                 do_respawn(faction_b);
                 balance_spawners();
-                delay(Options.view_delay);
+                if (!headless)
+                    delay(Options.view_delay);
                 clear_messages();
                 dump_messages();
                 ASSERT(you.pet_target == MHITNOT);
@@ -834,7 +846,12 @@ namespace arena
         // ball lightning or ballistomycete spores winning the fight via suicide.
         // The sanity checking is probably just paranoia.
         bool was_tied = false;
-        if (!faction_a.won && !faction_b.won)
+        if (turn_limit > 0 && turns >= turn_limit)
+        {
+            ties++;
+            was_tied = true;
+        }
+        else if (!faction_a.won && !faction_b.won)
         {
             if (faction_a.active_members > 0)
             {
@@ -929,7 +946,8 @@ namespace arena
 
         if (file != nullptr)
             end(0, false, "Results file already open");
-        file = fopen("arena.result", "w");
+        if (!headless)
+            file = fopen("arena.result", "w");
 
         if (file != nullptr)
         {
@@ -1000,7 +1018,7 @@ namespace arena
             }
             do_fight();
 
-            if (trials_done < total_trials)
+            if (trials_done < total_trials && !headless)
                 delay(Options.view_delay * 5);
         }
         while (!contest_cancelled && trials_done < total_trials);
@@ -1012,7 +1030,8 @@ namespace arena
                  faction_b.desc.c_str(), trials_done - team_a_wins - ties,
                  ties);
         }
-        delay(Options.view_delay * 5);
+        if (!headless)
+            delay(Options.view_delay * 5);
 
         write_results();
     }
@@ -1402,3 +1421,28 @@ NORETURN void run_arena(const string& teams)
     arena::global_shutdown();
     game_ended();
 }
+
+/**
+ * Run an arena contest without touching the display, and return once it
+ * is over rather than ending the game.
+ *
+ * @param teams      The arena specification, as for -arena.
+ * @param max_turns  Declare a tie after this many turns of a fight; zero
+ *                   for no limit.
+ */
+void run_arena_headless(const string& teams, int max_turns)
+{
+    _init_arena();
+
+    ASSERT(!crawl_state.arena_suspended);
+
+#ifdef WIZARD
+    unwind_bool wiz(you.wizard, true);
+#endif
+    unwind_bool hl(arena::headless, true);
+    unwind_var<int> limit(arena::turn_limit, max_turns);
+
+    arena::global_setup(teams);
+    arena::simulate();
+    arena::global_shutdown();
+}
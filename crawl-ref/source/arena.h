@@ -14,6 +14,7 @@ struct mgen_data;
 struct coord_def;
 
 NORETURN void run_arena(const string& teams);
+void run_arena_headless(const string& teams, int max_turns);
 
 monster_type arena_pick_random_monster(const level_id &place);
 
@@ -698,10 +698,67 @@ void bolt::apply_beam_conducts()
     }
 }
 
+// Rays found for tracers while a tracer_ray_cache is active. Monsters
+// weighing up their spells keep tracing along the same few lines, so a
+// handful of slots is plenty.
+struct cached_tracer_ray
+{
+    coord_def source;
+    coord_def target;
+    bool found;
+    ray_def ray;
+};
+
+static const int NUM_TRACER_RAYS = 8;
+static cached_tracer_ray _tracer_rays[NUM_TRACER_RAYS];
+static int _num_tracer_rays = 0;
+static int _tracer_ray_cache_depth = 0;
+
+tracer_ray_cache::tracer_ray_cache()
+{
+    if (!_tracer_ray_cache_depth++)
+        _num_tracer_rays = 0;
+}
+
+tracer_ray_cache::~tracer_ray_cache()
+{
+    --_tracer_ray_cache_depth;
+}
+
+// find_ray() with opc_solid_see, remembering the answer for tracers.
+// A failed find_ray() leaves the ray alone, so a cached failure does too.
+static bool _find_solid_see_ray(const bolt &beam, ray_def &ray)
+{
+    if (!beam.is_tracer || !_tracer_ray_cache_depth)
+        return find_ray(beam.source, beam.target, ray, opc_solid_see);
+
+    for (int i = 0; i < _num_tracer_rays; ++i)
+    {
+        const cached_tracer_ray &cached = _tracer_rays[i];
+        if (cached.source == beam.source && cached.target == beam.target)
+        {
+            if (cached.found)
+                ray = cached.ray;
+            return cached.found;
+        }
+    }
+
+    const bool found = find_ray(beam.source, beam.target, ray, opc_solid_see);
+    cached_tracer_ray &slot = _tracer_rays[_num_tracer_rays % NUM_TRACER_RAYS];
+    slot.source = beam.source;
+    slot.target = beam.target;
+    slot.found  = found;
+    if (found)
+        slot.ray = ray;
+    if (_num_tracer_rays < NUM_TRACER_RAYS)
+        ++_num_tracer_rays;
+    return found;
+}
+
 void bolt::choose_ray()
 {
     if ((!chose_ray || reflections > 0)
-        && !find_ray(source, target, ray, opc_solid_see)
+        && !_find_solid_see_ray(*this, ray)
         // If fire is blocked, at least try a visible path so the
         // error message is better.
         && !find_ray(source, target, ray, opc_default))
@@ -1014,21 +1071,53 @@ void bolt::affect_cell()
         affect_ground();
 }
 
-static void _undo_tracer(bolt &orig, bolt &copy)
+// The parts of a bolt that firing a tracer may change, so that they can
+// be put back afterwards without copying the whole bolt.
+struct tracer_state
 {
-    // FIXME: we should have a better idea of what gets changed!
-    orig.target           = copy.target;
-    orig.source           = copy.source;
-    orig.aimed_at_spot    = copy.aimed_at_spot;
-    orig.extra_range_used = copy.extra_range_used;
-    orig.auto_hit         = copy.auto_hit;
-    orig.ray              = copy.ray;
-    orig.colour           = copy.colour;
-    orig.flavour          = copy.flavour;
-    orig.real_flavour     = copy.real_flavour;
-    orig.bounces          = copy.bounces;
-    orig.bounce_pos       = copy.bounce_pos;
-}
+    coord_def target;
+    coord_def source;
+    bool aimed_at_spot;
+    int extra_range_used;
+    bool auto_hit;
+    ray_def ray;
+    colour_t colour;
+    beam_type flavour;
+    beam_type real_flavour;
+    int bounces;
+    coord_def bounce_pos;
+
+    void save(const bolt &beam)
+    {
+        target           = beam.target;
+        source           = beam.source;
+        aimed_at_spot    = beam.aimed_at_spot;
+        extra_range_used = beam.extra_range_used;
+        auto_hit         = beam.auto_hit;
+        ray              = beam.ray;
+        colour           = beam.colour;
+        flavour          = beam.flavour;
+        real_flavour     = beam.real_flavour;
+        bounces          = beam.bounces;
+        bounce_pos       = beam.bounce_pos;
+    }
+
+    void restore(bolt &beam) const
+    {
+        // FIXME: we should have a better idea of what gets changed!
+        beam.target           = target;
+        beam.source           = source;
+        beam.aimed_at_spot    = aimed_at_spot;
+        beam.extra_range_used = extra_range_used;
+        beam.auto_hit         = auto_hit;
+        beam.ray              = ray;
+        beam.colour           = colour;
+        beam.flavour          = flavour;
+        beam.real_flavour     = real_flavour;
+        beam.bounces          = bounces;
+        beam.bounce_pos       = bounce_pos;
+    }
+};
 
 // This saves some important things before calling fire().
 void bolt::fire()
@@ -1040,19 +1129,17 @@ void bolt::fire()
 
     if (is_tracer)
     {
-        bolt boltcopy = *this;
+        tracer_state saved, saved_explosion;
+        saved.save(*this);
         if (special_explosion != nullptr)
-            boltcopy.special_explosion = new bolt(*special_explosion);
+            saved_explosion.save(*special_explosion);
 
         do_fire();
 
         if (special_explosion != nullptr)
-        {
-            _undo_tracer(*special_explosion, *boltcopy.special_explosion);
-            delete boltcopy.special_explosion;
-        }
+            saved_explosion.restore(*special_explosion);
 
-        _undo_tracer(*this, boltcopy);
+        saved.restore(*this);
     }
     else
         do_fire();
@@ -321,6 +321,17 @@ bool curare_actor(actor* source, actor* target, int levels, string name,
 int silver_damages_victim(actor* victim, int damage, string &dmg_msg);
 void fire_tracer(const monster* mons, bolt &pbolt,
                   bool explode_only = false, bool explosion_hole = false);
+
+// While one of these is alive, monster tracers reuse the ray found for a
+// (source, target) pair instead of searching for it again. Only keep one
+// around code that fires tracers without changing the map.
+class tracer_ray_cache
+{
+public:
+    tracer_ray_cache();
+    ~tracer_ray_cache();
+};
+
 bool imb_can_splash(coord_def origin, coord_def center,
                     vector<coord_def> path_taken, coord_def target);
 spret_type zapping(zap_type ztype, int power, bolt &pbolt,
@@ -0,0 +1,292 @@
+/**
+ * @file
+ * @brief Headless arena throughput benchmarks (-bench).
+ *
+ * Each scenario is a seeded arena contest run with no display. For every
+ * scenario we report how fast monsters and the world advanced, how much
+ * LOS and pathfinding work was done, and the peak RSS so far, as a JSON
+ * array on stdout. With -bench-baseline, the results are also compared
+ * against an earlier run's output, and the exit status is non-zero if
+ * any scenario got slower (or bigger) than -bench-threshold allows.
+**/
+
+#include "AppHdr.h"
+
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#ifndef TARGET_OS_WINDOWS
+# include <sys/resource.h>
+#endif
+
+#include "arena.h"
+#include "end.h"
+#include "json.h"
+#include "json-wrapper.h"
+#include "options.h"
+#include "random.h"
+#include "state.h"
+#include "stringutil.h"
+#include "syscalls.h"
+
+bench_counters bench_counts;
+
+struct bench_scenario
+{
+    const char *name;
+    const char *teams;     // arena specification
+    uint32_t    seed;
+    int         max_turns; // per fight, after which it is declared a tie
+};
+
+// Keep the names stable: they are what baselines are matched on. Most of
+// these mirror the arena cases in test/stress/run.
+static const bench_scenario scenarios[] =
+{
+    { "cerebov", "cerebov v test spawner", 1, 3000 },
+    { "pan_lords", "cerebov, lom lobon, mnoleg, gloorx vloq v ereshkigal, "
+                   "asmodeus, antaeus, dispater t:3", 1, 2000 },
+    { "miscasts", "miscasts 5 pandemonium lord v 20 20-headed hydra t:3",
+      1, 1000 },
+    { "kraken", "kraken v spectral kraken arena:small_deep_pool t:5",
+      1, 1000 },
+    { "orc_war", "20 orc warrior, 5 orc wizard, orc high priest "
+                 "v 30 kobold, 10 gnoll t:3", 1, 1000 },
+    { "dragons", "8 fire dragon v 8 ice dragon t:3", 1, 1000 },
+};
+
+struct bench_result
+{
+    string name;
+    double seconds;
+    bench_counters counts;
+    long peak_rss_kb;
+};
+
+static long _peak_rss_kb()
+{
+#ifdef TARGET_OS_WINDOWS
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+# ifdef TARGET_OS_MACOSX
+    return usage.ru_maxrss / 1024; // bytes, not kilobytes
+# else
+    return usage.ru_maxrss;
+# endif
+#endif
+}
+
+static double _per_sec(uint64_t count, double seconds)
+{
+    return seconds > 0 ? count / seconds : 0;
+}
+
+static double _monster_rate(const bench_result &res)
+{
+    return _per_sec(res.counts.monster_turns, res.seconds);
+}
+
+static double _player_rate(const bench_result &res)
+{
+    return _per_sec(res.counts.player_turns, res.seconds);
+}
+
+static bench_result _run_scenario(const bench_scenario &scen)
+{
+    seed_rng(scen.seed);
+    bench_counts = bench_counters();
+
+    const auto start = chrono::steady_clock::now();
+    run_arena_headless(scen.teams, scen.max_turns);
+    const chrono::duration<double> elapsed
+        = chrono::steady_clock::now() - start;
+
+    bench_result res;
+    res.name = scen.name;
+    res.seconds = elapsed.count();
+    res.counts = bench_counts;
+    res.peak_rss_kb = _peak_rss_kb();
+    return res;
+}
+
+static JsonNode *_result_json(const bench_result &res)
+{
+    JsonNode *obj(json_mkobject());
+    json_append_member(obj, "name", json_mkstring(res.name.c_str()));
+    json_append_member(obj, "seconds", json_mknumber(res.seconds));
+    json_append_member(obj, "monster_turns",
+                       json_mknumber(res.counts.monster_turns));
+    json_append_member(obj, "player_turns",
+                       json_mknumber(res.counts.player_turns));
+    json_append_member(obj, "monster_turns_per_sec",
+                       json_mknumber(_monster_rate(res)));
+    json_append_member(obj, "player_turns_per_sec",
+                       json_mknumber(_player_rate(res)));
+    json_append_member(obj, "los_calls",
+                       json_mknumber(res.counts.los_calls));
+    json_append_member(obj, "pathfinds",
+                       json_mknumber(res.counts.pathfinds));
+    json_append_member(obj, "map_info_allocs",
+                       json_mknumber(res.counts.map_info_allocs));
+    json_append_member(obj, "map_info_allocs_per_turn",
+                       json_mknumber(res.counts.player_turns
+                           ? (double) res.counts.map_info_allocs
+                             / res.counts.player_turns
+                           : 0));
+    json_append_member(obj, "peak_rss_kb", json_mknumber(res.peak_rss_kb));
+    return obj;
+}
+
+static string _read_whole_file(const string &path)
+{
+    string text;
+    FILE *f = fopen_u(path.c_str(), "r");
+    if (!f)
+        end(1, true, "Can't read benchmark baseline %s", path.c_str());
+
+    char buf[4096];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), f)) > 0)
+        text.append(buf, got);
+    fclose(f);
+    return text;
+}
+
+static double _baseline_number(JsonNode *scen, const char *key)
+{
+    JsonNode *num = json_find_member(scen, key);
+    return num && num->tag == JSON_NUMBER ? num->number_ : 0;
+}
+
+// Is now worse than base by more than the threshold? For rates, lower is
+// worse; otherwise higher is.
+static bool _regressed(double now, double base, bool is_rate)
+{
+    if (base <= 0)
+        return false;
+
+    const double slack = crawl_state.bench_threshold / 100.0;
+    return is_rate ? now < base * (1 - slack)
+                   : now > base * (1 + slack);
+}
+
+/**
+ * Compare results against a baseline produced by an earlier -bench run,
+ * reporting each regression on stderr.
+ *
+ * @return the number of regressions found.
+ */
+static int _compare_to_baseline(const vector<bench_result> &results,
+                                const string &path)
+{
+    JsonWrapper baseline(json_decode(_read_whole_file(path).c_str()));
+    if (!baseline.node || baseline.node->tag != JSON_ARRAY)
+        end(1, false, "Malformed benchmark baseline %s", path.c_str());
+
+    int regressions = 0;
+    for (const bench_result &res : results)
+    {
+        JsonNode *base = nullptr;
+        JsonNode *scen;
+        json_foreach(scen, baseline.node)
+        {
+            JsonNode *name = json_find_member(scen, "name");
+            if (name && name->tag == JSON_STRING && res.name == name->string_)
+            {
+                base = scen;
+                break;
+            }
+        }
+
+        if (!base)
+        {
+            fprintf(stderr, "%s: not in baseline\n", res.name.c_str());
+            continue;
+        }
+
+        const struct
+        {
+            const char *key;
+            double now;
+            bool is_rate;
+        } metrics[] =
+        {
+            { "monster_turns_per_sec", _monster_rate(res), true },
+            { "player_turns_per_sec", _player_rate(res), true },
+            { "peak_rss_kb", (double) res.peak_rss_kb, false },
+        };
+
+        for (const auto &metric : metrics)
+        {
+            const double was = _baseline_number(base, metric.key);
+            if (_regressed(metric.now, was, metric.is_rate))
+            {
+                fprintf(stderr, "%s: %s regressed from %.1f to %.1f\n",
+                        res.name.c_str(), metric.key, was, metric.now);
+                regressions++;
+            }
+        }
+    }
+
+    return regressions;
+}
+
+NORETURN void run_benchmarks()
+{
+    if (crawl_state.benches_selected.size() == 1
+        && crawl_state.benches_selected[0] == "list")
+    {
+        for (const bench_scenario &scen : scenarios)
+            printf("%-12s %s\n", scen.name, scen.teams);
+        end(0);
+    }
+
+    for (const string &want : crawl_state.benches_selected)
+    {
+        bool found = false;
+        for (const bench_scenario &scen : scenarios)
+            if (want == scen.name)
+                found = true;
+        if (!found)
+            end(1, false, "No benchmark scenario named '%s'", want.c_str());
+    }
+
+    crawl_state.type = GAME_TYPE_ARENA;
+    crawl_state.show_more_prompt = false;
+    crawl_state.disables.set(DIS_DELAY);
+    Options.restart_after_game = false;
+
+    vector<bench_result> results;
+    for (const bench_scenario &scen : scenarios)
+    {
+        if (!crawl_state.benches_selected.empty()
+            && find(crawl_state.benches_selected.begin(),
+                    crawl_state.benches_selected.end(), scen.name)
+               == crawl_state.benches_selected.end())
+        {
+            continue;
+        }
+
+        fprintf(stderr, "bench: %s\n", scen.name);
+        results.push_back(_run_scenario(scen));
+    }
+
+    JsonWrapper json(json_mkarray());
+    for (const bench_result &res : results)
+        json_append_element(json.node, _result_json(res));
+    printf("%s\n", json.to_string().c_str());
+    fflush(stdout);
+
+    int regressions = 0;
+    if (!crawl_state.bench_baseline.empty())
+    {
+        regressions = _compare_to_baseline(results,
+                                           crawl_state.bench_baseline);
+    }
+
+    end(regressions ? 1 : 0);
+}
@@ -0,0 +1,21 @@
+/**
+ * @file
+ * @brief Headless arena throughput benchmarks (-bench).
+**/
+
+#pragma once
+
+// Work done since the last benchmark scenario started. These are counted
+// unconditionally; an increment is cheaper than anything around it.
+struct bench_counters
+{
+    uint64_t monster_turns;
+    uint64_t player_turns;
+    uint64_t los_calls;
+    uint64_t pathfinds;
+    uint64_t map_info_allocs; // map_cell info objects not from the pool
+};
+
+extern bench_counters bench_counts;
+
+NORETURN void run_benchmarks();
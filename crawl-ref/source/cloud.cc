@@ -30,6 +30,7 @@
 #include "mon-death.h"
 #include "mon-place.h"
 #include "nearby-danger.h" // Compass (for random_walk, CloudGenerator)
+#include "profiler.h"
 #include "religion.h"
 #include "shout.h"
 #include "spl-util.h"
@@ -560,6 +561,8 @@ static void _handle_spectral_cloud(const cloud_struct& cloud)
 
 void manage_clouds()
 {
+    PROF_ZONE("manage_clouds");
+
     // We can't iterate over env.cloud directly because _dissipate_cloud
     // will remove this cloud and invalidate our iterator.
     vector<cloud_struct *> cloud_ptrs;
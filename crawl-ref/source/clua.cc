@@ -10,12 +10,14 @@
 #include "files.h"
 #include "libutil.h"
 #include "l-libs.h"
+#include "maps.h"
 #include "maybe-bool.h"
 #include "misc.h" // erase_val
 #include "options.h"
 #include "state.h"
 #include "stringutil.h"
 #include "syscalls.h"
+#include "tags.h"
 #include "unicode.h"
 #include "version.h"
 
@@ -288,6 +290,147 @@ bool CLua::is_path_safe(string s, bool trusted)
            && (trusted || s.find("dlua") != 0);
 }
 
+/////////////////////////////////////////////////////////////////////
+// Compiled Lua cache
+//
+// Every process start compiles the same dlua and clua files. We keep the
+// bytecode (as produced by lua_dump) in the des cache directory, keyed by
+// the file's path, size and modification time, and load that instead of
+// the source when it is still current.
+//
+// Lua doesn't verify bytecode, so only trusted loads of the game's own
+// dlua and clua files go through the cache; anything an init file pulls in
+// is always compiled from source.
+
+static bool _lua_cacheable(string filename, bool trusted)
+{
+    lowercase(filename);
+    return trusted && (starts_with(filename, "dlua/")
+                       || starts_with(filename, "clua/"));
+}
+
+// The source's size and modification time, which a cache entry must match.
+// Size catches most edits made within the same second as the last one.
+static bool _lua_source_stamp(const string &file, int64_t &size,
+                              int64_t &mtime)
+{
+    FILE *fp = fopen_u(file.c_str(), "rb");
+    if (!fp)
+        return false;
+    size = file_size(fp);
+    mtime = file_modtime(fp);
+    fclose(fp);
+    return true;
+}
+
+static string _lua_cache_path(const string &filename)
+{
+    string name = filename;
+    for (char &c : name)
+        if (c == '/' || c == '\\')
+            c = '_';
+    return get_descache_path(name, ".luac");
+}
+
+// Only use the cache once the des cache directory exists; Lua is started
+// before the options that decide where it lives have all been read.
+static bool _lua_cache_usable()
+{
+    return dir_exists(savedir_versioned_path("des"));
+}
+
+// One lock covers all of the compiled Lua files, as the des cache's locks
+// do for each .des file: shared while reading, exclusive while writing.
+static string _lua_cache_lock()
+{
+    return get_descache_path("lua", ".lk");
+}
+
+static void _marshall_lua_cache_header(writer &outf, const string &path,
+                                       int64_t size, int64_t mtime)
+{
+    marshallUByte(outf, TAG_MAJOR_VERSION);
+    marshallUByte(outf, TAG_MINOR_VERSION);
+    marshallSigned(outf, size);
+    marshallSigned(outf, mtime);
+    marshallString(outf, path);
+    marshallString(outf, Version::Long);
+    marshallString(outf, LUA_RELEASE);
+}
+
+static bool _read_lua_cache(const string &filename, const string &path,
+                            int64_t size, int64_t mtime, string &compiled)
+{
+    if (!_lua_cache_usable())
+        return false;
+
+    file_lock lock(_lua_cache_lock(), "rb", false);
+    FILE *fp = fopen_u(_lua_cache_path(filename).c_str(), "rb");
+    if (!fp)
+        return false;
+
+    bool ok = false;
+    try
+    {
+        reader inf(fp);
+        ok = unmarshallUByte(inf) == TAG_MAJOR_VERSION
+             && unmarshallUByte(inf) == TAG_MINOR_VERSION
+             && unmarshallSigned(inf) == size
+             && unmarshallSigned(inf) == mtime
+             && unmarshallString(inf) == path
+             && unmarshallString(inf) == Version::Long
+             && unmarshallString(inf) == LUA_RELEASE;
+        if (ok)
+            unmarshallString4(inf, compiled);
+    }
+    catch (short_read_exception &E)
+    {
+        ok = false;
+    }
+    fclose(fp);
+    if (!ok)
+        compiled.clear();
+    return ok;
+}
+
+static int _lua_cache_chunk_writer(lua_State *ls, const void *p, size_t sz,
+                                   void *ud)
+{
+    static_cast<string*>(ud)->append(static_cast<const char *>(p), sz);
+    return 0;
+}
+
+// Dump the function on top of the stack (leaving it there) to the cache.
+static void _write_lua_cache(lua_State *ls, const string &filename,
+                             const string &path, int64_t size,
+                             int64_t mtime)
+{
+    if (!_lua_cache_usable())
+        return;
+
+    string compiled;
+    if (lua_dump(ls, _lua_cache_chunk_writer, &compiled) || compiled.empty())
+        return;
+
+    file_lock lock(_lua_cache_lock(), "wb", false);
+    const string cache = _lua_cache_path(filename);
+    FILE *fp = fopen_u(cache.c_str(), "wb");
+    if (!fp)
+        return;
+
+    {
+        writer outf(cache, fp, true);
+        _marshall_lua_cache_header(outf, path, size, mtime);
+        marshallString4(outf, compiled);
+    }
+
+    const bool written = !ferror(fp);
+    fclose(fp);
+    // Don't leave a truncated file behind for the next reader.
+    if (!written)
+        unlink_u(cache.c_str());
+}
+
 int CLua::loadfile(lua_State *ls, const char *filename, bool trusted,
                    bool die_on_fail)
 {
@@ -310,14 +453,33 @@ int CLua::loadfile(lua_State *ls, const char *filename, bool trusted,
         return -1;
     }
 
+    // prefixing with @ stops lua from adding [string "%s"]
+    const string chunkname = "@" + file;
+    int64_t size = 0, mtime = 0;
+    const bool cacheable = _lua_cacheable(filename, trusted)
+                           && _lua_source_stamp(file, size, mtime);
+
+    string compiled;
+    if (cacheable && _read_lua_cache(filename, file, size, mtime, compiled)
+        && !luaL_loadbuffer(ls, compiled.data(), compiled.length(),
+                            chunkname.c_str()))
+    {
+        return 0;
+    }
+    // A stale or foreign cache just means compiling from source again.
+    if (!compiled.empty())
+        lua_pop(ls, 1);
+
     FileLineInput f(file.c_str());
     string script;
     while (!f.eof())
         script += f.get_line() + "\n";
 
-    // prefixing with @ stops lua from adding [string "%s"]
-    return luaL_loadbuffer(ls, &script[0], script.length(),
-                           ("@" + file).c_str());
+    const int err = luaL_loadbuffer(ls, &script[0], script.length(),
+                                    chunkname.c_str());
+    if (!err && cacheable)
+        _write_lua_cache(ls, filename, file, size, mtime);
+    return err;
 }
 
 int CLua::execfile(const char *filename, bool trusted, bool die_on_fail,
@@ -1399,6 +1399,9 @@ int list_wizard_commands(bool do_redraw_screen)
                        "<w>Ctrl-T</w> dungeon (D)Lua interpreter\n"
                        "<w>Ctrl-U</w> client (C)Lua interpreter\n"
                        "<w>Ctrl-X</w> Xom effect stats\n"
+#ifdef PROFILE_ZONES
+                       "<w>Ctrl-Y</w> dump profiling zones\n"
+#endif
 #ifdef DEBUG_DIAGNOSTICS
                        "<w>Ctrl-Q</w> make some debug messages quiet\n"
 #endif
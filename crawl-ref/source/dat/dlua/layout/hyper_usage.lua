@@ -168,40 +168,17 @@ end
 -- - this allows this grid to be joined onto existing features on the map.
 -- Features inside the map can be flagged for internal connection
 -- - e.g. placing rooms within rooms, or carving into a rock area inside the room.
+-- Walls next to open space become carvable and get an anchor facing into it,
+-- open space next to anything solid is marked as buffer, and every cell is
+-- then reapplied with set_usage to update the eligibles and anchors lists.
+-- This runs over every cell of the map (and of every room), so it's done
+-- natively; see l-dgnhyper.cc.
 function hyper.usage.analyse_grid_usage(usage_grid,options)
+  dgn.hyper_analyse_usage(usage_grid)
+end
 
-  local get = hyper.usage.get_usage
-  local set = hyper.usage.set_usage
-
-  -- TODO: An optimised zonify would do this job pretty well and
-  -- possibly get more useful information.
-
-  for x = 0, usage_grid.width-1, 1 do
-    for y = 0, usage_grid.height-1, 1 do
-      local usage = get(usage_grid,x,y)
-      -- Ignore vaults
-      if not usage.vault then
-        -- Check walls for carvability
-        if usage.wall then
-          for i,normal in ipairs(vector.normals) do
-            local near = get(usage_grid,x+normal.x,y+normal.y)
-            if near ~= nil and not near.solid then
-              usage.carvable = true
-              table.insert(usage.anchors,{ normal = vector.normals[(normal.dir+2)%4 + 1], pos = { x=0,y=0 }, grid_pos = { x=x,y=y }})
-            end
-          end
-        -- Check open spaces for bordering walls
-        elseif not usage.solid then
-          local no_wall = true
-          for i,normal in ipairs(vector.directions) do
-            local near = hyper.usage.get_usage(usage_grid,x+normal.x,y+normal.y)
-            if near ~= nil and near.solid then usage.buffer = true end
-          end
-        end
-        -- Reapply the usage - this will update the
-        -- global anchors list
-        set(usage_grid,x,y,usage)
-      end
-    end
-  end
+-- A usage grid of the whole map as it stands: the same as
+-- new_usage(width, height, hyper.usage.grid_initialiser), done natively.
+function hyper.usage.new_map_usage(width, height)
+  return dgn.hyper_new_usage(width, height)
 end
@@ -458,17 +458,29 @@ function procedural.minmax_map(val,min,max)
 end
 
 -- Render functions
+
+-- Call fcell(x,y) for every cell of the area (column by column, as mapgrd
+-- loops do, so random draws happen in the same order), then write all
+-- the glyphs it returned in one go.
+local function render_area(e,x1,y1,x2,y2,fcell)
+  local rows = {}
+  for y = y1,y2,1 do rows[y-y1+1] = {} end
+  for x = x1,x2,1 do
+    for y = y1,y2,1 do
+      rows[y-y1+1][x-x1+1] = fcell(x,y)
+    end
+  end
+  e.set_area { x1 = x1, y1 = y1, width = x2-x1+1, rows = rows }
+end
+
 function procedural.render_map(e, fval, fresult)
 
   local gxm,gym = dgn.max_bounds()
   e.extend_map { width = gxm, height = gym, fill = 'x' }
-  for x = 1,gxm-2,1 do
-    for y = 1,gym-2,1 do
-      local val = fval(x,y)
-      local r = fresult(val,x,y)
-      if r ~= nil then e.mapgrd[x][y] = r end
-    end
-  end
+  render_area(e, 1, 1, gxm-2, gym-2, function(x,y)
+    local val = fval(x,y)
+    return fresult(val,x,y)
+  end)
 
 end
 
@@ -477,11 +489,8 @@ function procedural.render_map_area(e,x1,y1,x2,y2,fval,brush,space)
   if type(brush)=="string" then
     fbrush = function(v) return (v <= 1) and brush or space end
   end
-  for x = x1,x2,1 do
-    for y = y1,y2,1 do
-      local val = fval(x-x1,y-y1,x,y)
-      local r = fbrush(val,x,y)
-      if r ~= nil then e.mapgrd[x][y] = r end
-    end
-  end
+  render_area(e, x1, y1, x2, y2, function(x,y)
+    local val = fval(x-x1,y-y1,x,y)
+    return fbrush(val,x,y)
+  end)
 end
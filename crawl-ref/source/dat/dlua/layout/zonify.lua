@@ -144,10 +144,13 @@ function zonify.map_map(e)
 
   -- TODO: Can we check size of current map after extend_map?
   local gxm,gym = dgn.max_bounds()
+  -- Read the whole map once rather than going through mapgrd per cell.
+  local rows = e.get_area { x1 = 0, y1 = 0, x2 = gxm-1, y2 = gym-1 }
   return zonify.map(
     { x1 = 1, y1 = 1, x2 = gxm-2, y2 = gym-2 },
     function(x,y)
-      return dgn.in_bounds(x,y) and { glyph = e.mapgrd[x][y] } or nil
+      return dgn.in_bounds(x,y)
+             and { glyph = string.sub(rows[y+1], x+1, x+1) } or nil
     end,
     function(val)
       return string.find(wall,val.glyph,1,true) and "wall" or "floor"
@@ -156,36 +159,26 @@ function zonify.map_map(e)
 
 end
 
+-- Fills all but the largest num_to_keep floor zones of the map. This is
+-- fill_smallest_zones over map_map, done natively (see fill_small_zones in
+-- l-dgnbld.cc) since it's run on most layouts.
 function zonify.map_fill_zones(e, num_to_keep, glyph, min_zone_size)
   if num_to_keep == nil then num_to_keep = 1 end
   if glyph == nil then glyph = 'x' end
   if min_zone_size == nil then min_zone_size = 1 end
 
-  local zonemap = zonify.map_map(e)
-  zonify.fill_smallest_zones(zonemap, num_to_keep, "floor",
-                             function(x,y,cell) e.mapgrd[x][y] = glyph end, min_zone_size)
+  e.fill_small_zones { keep = num_to_keep, fill = glyph,
+                       wall = "wlxcvbtg", min_size = min_zone_size }
 end
 
+-- The same, but with lava counting as floor.
 function zonify.map_fill_lava_zones(e, num_to_keep, glyph, min_zone_size)
   if num_to_keep == nil then num_to_keep = 1 end
   if glyph == nil then glyph = 'x' end
   if min_zone_size == nil then min_zone_size = 1 end
 
-  local wall = "wxcvbtg"
-
-  -- TODO: Can we check size of current map after extend_map?
-  local gxm,gym = dgn.max_bounds()
-  local zonemap = zonify.map(
-    { x1 = 1, y1 = 1, x2 = gxm-2, y2 = gym-2 },
-    function(x,y)
-      return dgn.in_bounds(x,y) and { glyph = e.mapgrd[x][y] } or nil
-    end,
-    function(val)
-      return string.find(wall,val.glyph,1,true) and "wall" or "floor"
-    end
-  )
-  zonify.fill_smallest_zones(zonemap, num_to_keep, "floor",
-                             function(x,y,cell) e.mapgrd[x][y] = glyph end, min_zone_size)
+  e.fill_small_zones { keep = num_to_keep, fill = glyph,
+                       wall = "wxcvbtg", min_size = min_zone_size }
 end
 
 -- Zonifies the current dungeon grid
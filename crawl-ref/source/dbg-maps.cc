@@ -7,6 +7,8 @@
 
 #include "dbg-maps.h"
 
+#include <chrono>
+
 #include "branch.h"
 #include "chardump.h"
 #include "crash.h"
@@ -15,6 +17,7 @@
 #include "env.h"
 #include "initfile.h"
 #include "libutil.h"
+#include "mapdef.h"
 #include "maps.h"
 #include "message.h"
 #include "ng-init.h"
@@ -42,9 +45,15 @@ static map<string, string> errors;
 static string last_error;
 
 static int levels_tried = 0, levels_failed = 0;
-static int build_attempts = 0, level_vetoes = 0;
+static int build_attempts = 0, level_vetoes = 0, level_rollbacks = 0;
 // Map from message to counts.
 static map<string, int> veto_messages;
+// Stages retried from a checkpoint rather than rebuilding the level.
+static map<level_id, int> map_rollbacks;
+// Seconds spent in builder() for each branch, and the levels built.
+static map<branch_type, pair<double, int> > branch_build_time;
+// Of those, seconds spent taking and restoring stage checkpoints.
+static map<branch_type, double> branch_checkpoint_time;
 
 void mapstat_report_map_build_start()
 {
@@ -59,6 +68,17 @@ void mapstat_report_map_veto(const string &message)
     map_builds[level_id::current()].second++;
 }
 
+void mapstat_report_map_rollback()
+{
+    level_rollbacks++;
+    map_rollbacks[level_id::current()]++;
+}
+
+void mapstat_report_checkpoint_time(double seconds)
+{
+    branch_checkpoint_time[you.where_are_you] += seconds;
+}
+
 static bool _is_disconnected_level()
 {
     // Don't care about non-Dungeon levels.
@@ -92,7 +112,13 @@ static bool _do_build_level()
     }
 
     ++levels_tried;
-    if (!builder())
+    const auto start = chrono::steady_clock::now();
+    const bool built = builder();
+    const chrono::duration<double> elapsed
+        = chrono::steady_clock::now() - start;
+    branch_build_time[you.where_are_you].first += elapsed.count();
+    branch_build_time[you.where_are_you].second++;
+    if (!built)
     {
         ++levels_failed;
         // Abort level build failure in objstat since the statistics will be
@@ -406,6 +432,49 @@ static void _write_map_stats()
             fprintf(outf, "%3d) %s\n", i->first, i->second.c_str());
     }
 
+    fprintf(outf, "\n\nParsed spec caches:\n");
+    fprintf(outf, "%-6s %10s %10s %12s %7s\n", "spec", "hits", "misses",
+            "uncacheable", "hit %");
+    for (const spec_cache_counts &counts : spec_cache_stats())
+    {
+        const int total = counts.hits + counts.misses + counts.uncacheable;
+        fprintf(outf, "%-6s %10d %10d %12d %6.1f%%\n", counts.kind,
+                counts.hits, counts.misses, counts.uncacheable,
+                total ? counts.hits * 100.0 / total : 0.0);
+    }
+
+    if (!branch_build_time.empty())
+    {
+        fprintf(outf, "\n\nBuild times by branch (%d stage rollbacks):\n",
+                level_rollbacks);
+        fprintf(outf, "%-16s %6s %10s %10s %10s %7s %7s %9s\n", "branch",
+                "levels", "seconds", "ms/level", "ckpt ms/l", "tries",
+                "vetoes", "rollbacks");
+        for (const auto &entry : branch_build_time)
+        {
+            int tries = 0, vetoes = 0, rollbacks = 0;
+            for (const auto &build : map_builds)
+            {
+                if (build.first.branch != entry.first)
+                    continue;
+                tries += build.second.first;
+                vetoes += build.second.second;
+            }
+            for (const auto &rollback : map_rollbacks)
+                if (rollback.first.branch == entry.first)
+                    rollbacks += rollback.second;
+
+            const double secs = entry.second.first;
+            const double ckpt = branch_checkpoint_time[entry.first];
+            const int levels = entry.second.second;
+            fprintf(outf, "%-16s %6d %10.3f %10.2f %10.3f %7d %7d %9d\n",
+                    branches[entry.first].shortname, levels, secs,
+                    levels ? secs * 1000 / levels : 0.0,
+                    levels ? ckpt * 1000 / levels : 0.0,
+                    tries, vetoes, rollbacks);
+        }
+    }
+
     if (!unused_maps.empty() && !SysEnv.map_gen_range.get())
     {
         fprintf(outf, "\n\nUnused maps:\n\n");
@@ -23,6 +23,17 @@ void dgn_event_dispatcher::clear()
             grid_triggers[x][y].reset(nullptr);
 }
 
+bool dgn_event_dispatcher::empty() const
+{
+    if (global_event_mask || !listeners.empty())
+        return false;
+    for (int y = 0; y < GYM; ++y)
+        for (int x = 0; x < GXM; ++x)
+            if (grid_triggers[x][y])
+                return false;
+    return true;
+}
+
 void dgn_event_dispatcher::clear_listeners_at(const coord_def &pos)
 {
     grid_triggers[pos.x][pos.y].reset(nullptr);
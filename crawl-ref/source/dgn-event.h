@@ -101,6 +101,7 @@ public:
     }
 
     void clear();
+    bool empty() const;
     void clear_listeners_at(const coord_def &pos);
     bool has_listeners_at(const coord_def &pos) const;
     void move_listeners(const coord_def &from, const coord_def &to);
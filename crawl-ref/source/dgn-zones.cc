@@ -0,0 +1,117 @@
+/**
+ * @file
+ * @brief Connected-component labelling of the dungeon grid.
+ *
+ * A two-pass union-find labelling: the first pass gives every passable
+ * cell a provisional label, merging the labels of neighbours already
+ * scanned; the second resolves those to final zone numbers and collects
+ * each zone's statistics. This touches every cell twice, where flood
+ * filling each zone and then rescanning the map for its cells touched
+ * the map once per zone.
+**/
+
+#include "AppHdr.h"
+
+#include "dgn-zones.h"
+
+#include <cstring>
+
+#include "coord.h"
+#include "dungeon.h"
+#include "env.h"
+
+static int _zone_root(vector<int> &parent, int label)
+{
+    while (parent[label] != label)
+    {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+static void _zone_union(vector<int> &parent, int a, int b)
+{
+    a = _zone_root(parent, a);
+    b = _zone_root(parent, b);
+    if (a != b)
+        parent[max(a, b)] = min(a, b);
+}
+
+int dgn_label_zones(travel_distance_grid_t labels, dgn_zone_list &zones,
+                    bool (*passable)(const coord_def &),
+                    bool (*iswanted)(const coord_def &))
+{
+    memset(labels, 0, sizeof(travel_distance_grid_t));
+    zones.clear();
+
+    // Provisional labels and their union-find parents; parent[0] is a
+    // placeholder, so that label 0 can keep meaning "no zone".
+    vector<int> parent(1, 0);
+
+    // The neighbours that a row-by-row scan has already visited.
+    static const coord_def earlier[] =
+    {
+        coord_def(-1, 0), coord_def(-1, -1),
+        coord_def(0, -1), coord_def(1, -1),
+    };
+
+    for (int y = Y_BOUND_1; y <= Y_BOUND_2; ++y)
+        for (int x = X_BOUND_1; x <= X_BOUND_2; ++x)
+        {
+            const coord_def c(x, y);
+            if (!passable(c))
+                continue;
+
+            int label = 0;
+            for (const coord_def &delta : earlier)
+            {
+                const coord_def n = c + delta;
+                const int nlabel = map_bounds(n) ? labels[n.x][n.y] : 0;
+                if (!nlabel)
+                    continue;
+                if (!label)
+                    label = nlabel;
+                else
+                    _zone_union(parent, label, nlabel);
+            }
+
+            if (!label)
+            {
+                label = parent.size();
+                parent.push_back(label);
+            }
+            labels[x][y] = label;
+        }
+
+    // Provisional label roots to final zone numbers, handed out in scan
+    // order.
+    vector<int> zone_of(parent.size(), 0);
+    for (int y = Y_BOUND_1; y <= Y_BOUND_2; ++y)
+        for (int x = X_BOUND_1; x <= X_BOUND_2; ++x)
+        {
+            if (!labels[x][y])
+                continue;
+
+            const coord_def c(x, y);
+            int &zone = zone_of[_zone_root(parent, labels[x][y])];
+            if (!zone)
+            {
+                zones.push_back({ 0, false, false, c, c });
+                zone = zones.size();
+            }
+            labels[x][y] = zone;
+
+            dgn_zone &stats = zones[zone - 1];
+            stats.size++;
+            if (iswanted && !stats.wanted && iswanted(c))
+                stats.wanted = true;
+            if (env.level_map_mask(c) & MMT_VAULT)
+                stats.vault = true;
+            stats.tl.x = min(stats.tl.x, x);
+            stats.br.x = max(stats.br.x, x);
+            stats.br.y = y;
+        }
+
+    return zones.size();
+}
@@ -0,0 +1,32 @@
+/**
+ * @file
+ * @brief Connected-component labelling of the dungeon grid.
+**/
+
+#pragma once
+
+#include <vector>
+
+#include "travel-defs.h"
+
+// One 8-connected zone of the cells labelled by dgn_label_zones().
+struct dgn_zone
+{
+    int size;
+    bool wanted;        // Some cell in it satisfies the iswanted predicate.
+    bool vault;         // Some cell in it is masked MMT_VAULT.
+    coord_def tl, br;   // Bounding box, inclusive.
+};
+
+typedef vector<dgn_zone> dgn_zone_list;
+
+// Labels the zones of passable cells within map bounds, writing each
+// cell's zone number into labels (and 0 for cells in no zone). Zones are
+// numbered from 1 in the order a row-by-row scan of the map first meets
+// them, which is also the order flood filling from each unlabelled cell
+// in turn would number them; zone n is described by zones[n - 1].
+//
+// Returns the number of zones.
+int dgn_label_zones(travel_distance_grid_t labels, dgn_zone_list &zones,
+                    bool (*passable)(const coord_def &),
+                    bool (*iswanted)(const coord_def &) = nullptr);
@@ -8,6 +8,9 @@
 #include "dungeon.h"
 
 #include <algorithm>
+#ifdef DEBUG_STATISTICS
+#include <chrono>
+#endif
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -35,6 +38,7 @@
 #include "dgn-labyrinth.h"
 #include "dgn-overview.h"
 #include "dgn-shoals.h"
+#include "dgn-zones.h"
 #include "end.h"
 #include "english.h"
 #include "files.h"
@@ -57,6 +61,7 @@
 #include "nearby-danger.h"
 #include "notes.h"
 #include "place.h"
+#include "profiler.h"
 #include "randbook.h"
 #include "random.h"
 #include "religion.h"
@@ -83,7 +88,11 @@
 // DUNGEON BUILDERS
 static bool _build_level_vetoable(bool enable_random_maps,
                                   dungeon_feature_type dest_stairs_type);
-static void _build_dungeon_level(dungeon_feature_type dest_stairs_type);
+struct levelgen_progress;
+static void _build_level_layout(levelgen_progress &progress);
+static void _build_level_vaults(levelgen_progress &progress);
+static bool _build_level_finish(const levelgen_progress &progress,
+                                dungeon_feature_type dest_stairs_type);
 static bool _valid_dungeon_level();
 
 static bool _builder_by_type();
@@ -230,6 +239,85 @@ struct dgn_colour_override_manager
 typedef FixedArray< coloured_feature, GXM, GYM > dungeon_colour_grid;
 static unique_ptr<dungeon_colour_grid> dgn_colour_grid;
 
+// Stages of a level build. A veto in any stage after the first rolls the
+// level back to how it was when that stage started and tries just that
+// stage again, instead of throwing the whole level away.
+enum levelgen_stage
+{
+    LEVELGEN_LAYOUT,    // The layout or encompass vault.
+    LEVELGEN_VAULTS,    // Branch entrances, chance, mini- and extra vaults.
+    LEVELGEN_FINISH,    // Connectivity checks, monsters, items, fixups.
+    NUM_LEVELGEN_STAGES
+};
+
+// How many times a stage is tried from its checkpoint before going back
+// to the stage before it.
+#define LEVELGEN_STAGE_TRIES 3
+
+// What the stages of a build hand on to each other.
+struct levelgen_progress
+{
+    bool place_vaults;  // Does the layout want more vaults placed on it?
+    bool complete;      // Has the layout built the whole level?
+    unsigned nvaults;   // Vaults placed before LEVELGEN_VAULTS.
+};
+
+// The level and the builder's state as they were when a stage started.
+struct levelgen_checkpoint
+{
+    levelgen_progress progress;
+
+    // Only up to the last slot in use: a level being built uses few of
+    // them, and copying the rest would be most of the checkpoint's cost.
+    vector<item_def> item;
+    vector<monster> mons;
+    feature_grid grid;
+    FixedArray<terrain_property_t, GXM, GYM> pgrid;
+    FixedArray<unsigned short, GXM, GYM> mgrid;
+    FixedArray<int, GXM, GYM> igrid;
+    FixedArray<unsigned short, GXM, GYM> grid_colours;
+    map_mask level_map_mask;
+    map_mask level_map_ids;
+    string_set level_uniq_maps;
+    string_set level_uniq_map_tags;
+    string_set level_layout_types;
+    string level_build_method;
+    vector<vault_placement> level_vaults;
+    unique_ptr<grid_heightmap> heightmap;
+    FixedArray<tile_flavour, GXM, GYM> tile_flv;
+    vector<string> tile_names;
+    map<coord_def, cloud_struct> cloud;
+    map<coord_def, shop_struct> shop;
+    map<coord_def, trap_def> trap;
+    FixedVector<monster_type, MAX_MONS_ALLOC> mons_alloc;
+    map_markers markers;
+    CrawlHashTable properties;
+    int spawn_random_rate;
+    int density;
+    int forest_awoken_until;
+    vector<pair<coord_def, int> > sunlight;
+    uint32_t level_state;
+    colour_t floor_colour;
+    colour_t rock_colour;
+    map<mid_t, unsigned short> mid_cache;
+
+    vector<vault_placement> temp_vaults;
+    vector<string> you_vault_list;
+#ifdef DEBUG_STATISTICS
+    vector<string> you_all_vault_list;
+#endif
+    unique_ptr<dungeon_colour_grid> colour_grid;
+    bool check_connectivity;
+    int zones;
+    vector<god_type> temple_altar_list;
+    CrawlHashTable *current_temple_hash;
+
+    set<string> uniq_map_tags;
+    set<string> uniq_map_names;
+    FixedBitVector<NUM_MONSTERS> unique_creatures;
+    FixedVector<unique_item_status_type, MAX_UNRANDARTS> unique_items;
+};
+
 static string branch_epilogues[NUM_BRANCHES];
 
 static void _count_gold()
@@ -282,6 +370,8 @@ static void _count_gold()
  *********************************************************************/
 bool builder(bool enable_random_maps, dungeon_feature_type dest_stairs_type)
 {
+    PROF_ZONE("builder");
+
     // Re-check whether we're in a valid place, it leads to obscure errors
     // otherwise.
     ASSERT_RANGE(you.where_are_you, 0, NUM_BRANCHES);
@@ -327,7 +417,8 @@ bool builder(bool enable_random_maps, dungeon_feature_type dest_stairs_type)
         you.uniq_map_names = uniq_names;
     }
 
-    if (!crawl_state.map_stat_gen && !crawl_state.obj_stat_gen)
+    if (!crawl_state.map_stat_gen && !crawl_state.obj_stat_gen
+        && !crawl_state.background_levelgen)
     {
         // Failed to build level, bail out.
         if (crawl_state.need_save)
@@ -347,21 +438,210 @@ bool builder(bool enable_random_maps, dungeon_feature_type dest_stairs_type)
     return false;
 }
 
-static bool _build_level_vetoable(bool enable_random_maps,
-                                  dungeon_feature_type dest_stairs_type)
+#ifdef DEBUG_STATISTICS
+// Times a checkpoint or rollback, for mapstat to report what they cost.
+struct levelgen_checkpoint_timer
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    ~levelgen_checkpoint_timer()
+    {
+        const chrono::duration<double> elapsed
+            = chrono::steady_clock::now() - start;
+        mapstat_report_checkpoint_time(elapsed.count());
+    }
+};
+#endif
+
+// Take a checkpoint of the level as it is between stages. Returns nullptr
+// if the level has something in it that can't be copied back safely.
+static unique_ptr<levelgen_checkpoint>
+_levelgen_checkpoint(const levelgen_progress &progress)
 {
+    // Event listeners point into the markers, which are copied.
+    if (!dungeon_events.empty())
+        return nullptr;
+
 #ifdef DEBUG_STATISTICS
-    mapstat_report_map_build_start();
+    levelgen_checkpoint_timer timer;
 #endif
 
-    dgn_reset_level(enable_random_maps);
+    unique_ptr<levelgen_checkpoint> cp(new levelgen_checkpoint);
+    cp->progress = progress;
+
+    int nitems = MAX_ITEMS;
+    while (nitems > 0 && !env.item[nitems - 1].defined())
+        --nitems;
+    cp->item.assign(&env.item[0], &env.item[0] + nitems);
+
+    int nmons = MAX_MONSTERS;
+    while (nmons > 0 && env.mons[nmons - 1].type == MONS_NO_MONSTER)
+        --nmons;
+    cp->mons.assign(&env.mons[0], &env.mons[0] + nmons);
+
+    cp->grid                = env.grid;
+    cp->pgrid               = env.pgrid;
+    cp->mgrid               = env.mgrid;
+    cp->igrid               = env.igrid;
+    cp->grid_colours        = env.grid_colours;
+    cp->level_map_mask      = env.level_map_mask;
+    cp->level_map_ids       = env.level_map_ids;
+    cp->level_uniq_maps     = env.level_uniq_maps;
+    cp->level_uniq_map_tags = env.level_uniq_map_tags;
+    cp->level_layout_types  = env.level_layout_types;
+    cp->level_build_method  = env.level_build_method;
+    for (const auto &vp : env.level_vaults)
+        cp->level_vaults.push_back(*vp);
+    if (env.heightmap)
+        cp->heightmap.reset(new grid_heightmap(*env.heightmap));
+    cp->tile_flv            = env.tile_flv;
+    cp->tile_names          = env.tile_names;
+    cp->cloud               = env.cloud;
+    cp->shop                = env.shop;
+    cp->trap                = env.trap;
+    cp->mons_alloc          = env.mons_alloc;
+    cp->markers             = env.markers;
+    cp->properties          = env.properties;
+    cp->spawn_random_rate   = env.spawn_random_rate;
+    cp->density             = env.density;
+    cp->forest_awoken_until = env.forest_awoken_until;
+    cp->sunlight            = env.sunlight;
+    cp->level_state         = env.level_state;
+    cp->floor_colour        = env.floor_colour;
+    cp->rock_colour         = env.rock_colour;
+    cp->mid_cache           = env.mid_cache;
+
+    cp->temp_vaults         = Temp_Vaults;
+    cp->you_vault_list      = _you_vault_list;
+#ifdef DEBUG_STATISTICS
+    cp->you_all_vault_list  = _you_all_vault_list;
+#endif
+    if (dgn_colour_grid)
+        cp->colour_grid.reset(new dungeon_colour_grid(*dgn_colour_grid));
+    cp->check_connectivity  = dgn_check_connectivity;
+    cp->zones               = dgn_zones;
+    cp->temple_altar_list   = _temple_altar_list;
+    cp->current_temple_hash = _current_temple_hash;
 
-    if (player_in_branch(BRANCH_TEMPLE))
-        _setup_temple_altars(you.props);
+    cp->uniq_map_tags       = you.uniq_map_tags;
+    cp->uniq_map_names      = you.uniq_map_names;
+    cp->unique_creatures    = you.unique_creatures;
+    cp->unique_items        = you.unique_items;
+
+    return cp;
+}
+
+// Put the level back the way it was when the checkpoint was taken.
+static void _levelgen_rollback(const levelgen_checkpoint &cp,
+                               levelgen_progress &progress)
+{
+#ifdef DEBUG_STATISTICS
+    levelgen_checkpoint_timer timer;
+#endif
+
+    progress = cp.progress;
+
+    clear_subvault_stack();
+    dungeon_events.clear();
+
+    // Slots past the copied ones were empty; empty any the failed stage
+    // used. The grids are restored below.
+    for (int i = cp.item.size(); i < MAX_ITEMS; ++i)
+        if (env.item[i].defined())
+            env.item[i].clear();
+    copy(cp.item.begin(), cp.item.end(), &env.item[0]);
+
+    for (int i = cp.mons.size(); i < MAX_MONSTERS; ++i)
+        if (env.mons[i].type != MONS_NO_MONSTER)
+            env.mons[i].reset();
+    copy(cp.mons.begin(), cp.mons.end(), &env.mons[0]);
+
+    env.grid                = cp.grid;
+    env.pgrid               = cp.pgrid;
+    env.mgrid               = cp.mgrid;
+    env.igrid               = cp.igrid;
+    env.grid_colours        = cp.grid_colours;
+    env.level_map_mask      = cp.level_map_mask;
+    env.level_map_ids       = cp.level_map_ids;
+    env.level_uniq_maps     = cp.level_uniq_maps;
+    env.level_uniq_map_tags = cp.level_uniq_map_tags;
+    env.level_layout_types  = cp.level_layout_types;
+    env.level_build_method  = cp.level_build_method;
+    env.level_vaults.clear();
+    for (const vault_placement &vp : cp.level_vaults)
+        env.level_vaults.emplace_back(new vault_placement(vp));
+    env.heightmap.reset(cp.heightmap ? new grid_heightmap(*cp.heightmap)
+                                     : nullptr);
+    env.tile_flv            = cp.tile_flv;
+    env.tile_names          = cp.tile_names;
+    env.cloud               = cp.cloud;
+    env.shop                = cp.shop;
+    env.trap                = cp.trap;
+    env.mons_alloc          = cp.mons_alloc;
+    env.markers             = cp.markers;
+    env.properties          = cp.properties;
+    env.spawn_random_rate   = cp.spawn_random_rate;
+    env.density             = cp.density;
+    env.forest_awoken_until = cp.forest_awoken_until;
+    env.sunlight            = cp.sunlight;
+    env.level_state         = cp.level_state;
+    env.floor_colour        = cp.floor_colour;
+    env.rock_colour         = cp.rock_colour;
+    env.mid_cache           = cp.mid_cache;
+
+    Temp_Vaults             = cp.temp_vaults;
+    _you_vault_list         = cp.you_vault_list;
+#ifdef DEBUG_STATISTICS
+    _you_all_vault_list     = cp.you_all_vault_list;
+#endif
+    dgn_colour_grid.reset(cp.colour_grid
+                          ? new dungeon_colour_grid(*cp.colour_grid)
+                          : nullptr);
+    dgn_check_connectivity  = cp.check_connectivity;
+    dgn_zones               = cp.zones;
+    _temple_altar_list      = cp.temple_altar_list;
+    _current_temple_hash    = cp.current_temple_hash;
+
+    you.uniq_map_tags       = cp.uniq_map_tags;
+    you.uniq_map_names      = cp.uniq_map_names;
+    you.unique_creatures    = cp.unique_creatures;
+    you.unique_items        = cp.unique_items;
+}
+
+/**
+ * Run one try at one stage of the level build.
+ *
+ * First tries draw from the level generator as they always did, so a
+ * build that needs no retries is exactly what it was before stages. Each
+ * retry gets its own stream, keyed by retry_seed and the try, and leaves
+ * the level generator where the failed try left it.
+ *
+ * @return whether the stage succeeded; false if it was vetoed.
+ */
+static bool _build_level_stage(levelgen_stage stage, bool retry,
+                               uint64_t retry_seed, uint64_t run,
+                               levelgen_progress &progress,
+                               dungeon_feature_type dest_stairs_type)
+{
+    unique_ptr<rng_subgenerator> retry_rng;
+    if (retry)
+        retry_rng.reset(new rng_subgenerator(retry_seed, run << 8 | stage));
 
     try
     {
-        _build_dungeon_level(dest_stairs_type);
+        switch (stage)
+        {
+        case LEVELGEN_LAYOUT:
+            _build_level_layout(progress);
+            return true;
+        case LEVELGEN_VAULTS:
+            _build_level_vaults(progress);
+            return true;
+        case LEVELGEN_FINISH:
+            return _build_level_finish(progress, dest_stairs_type);
+        default:
+            die("Bad levelgen stage %d", stage);
+        }
     }
     catch (dgn_veto_exception& e)
     {
@@ -372,13 +652,63 @@ static bool _build_level_vetoable(bool enable_random_maps,
 #endif
         return false;
     }
+}
 
-    _dgn_set_floor_colours();
+static bool _build_level_vetoable(bool enable_random_maps,
+                                  dungeon_feature_type dest_stairs_type)
+{
+#ifdef DEBUG_STATISTICS
+    mapstat_report_map_build_start();
+#endif
+
+    dgn_reset_level(enable_random_maps);
 
-    if (crawl_state.game_standard_levelgen()
-        && !_valid_dungeon_level())
+    if (player_in_branch(BRANCH_TEMPLE))
+        _setup_temple_altars(you.props);
+
+    // Drawn only once something needs retrying.
+    uint64_t retry_seed = 0;
+    uint64_t runs = 0;
+
+    levelgen_progress progress = { false, false, 0 };
+    unique_ptr<levelgen_checkpoint> checkpoints[NUM_LEVELGEN_STAGES];
+    int tries[NUM_LEVELGEN_STAGES] = { 0 };
+
+    int stage = LEVELGEN_LAYOUT;
+    while (stage < NUM_LEVELGEN_STAGES && !progress.complete)
     {
-        return false;
+        if (stage != LEVELGEN_LAYOUT && !checkpoints[stage])
+            checkpoints[stage] = _levelgen_checkpoint(progress);
+
+        ++tries[stage];
+        if (_build_level_stage(static_cast<levelgen_stage>(stage),
+                               tries[stage] > 1, retry_seed, runs++,
+                               progress, dest_stairs_type))
+        {
+            ++stage;
+            continue;
+        }
+
+        // Go back to the latest stage that can still be retried; if that's
+        // the layout, the caller starts the level again.
+        while (stage != LEVELGEN_LAYOUT
+               && (!checkpoints[stage] || tries[stage] >= LEVELGEN_STAGE_TRIES))
+        {
+            checkpoints[stage].reset();
+            tries[stage] = 0;
+            --stage;
+        }
+        if (stage == LEVELGEN_LAYOUT)
+            return false;
+
+        dprf(DIAG_DNGN, "Rolling %s back to stage %d (try %d).",
+             level_id::current().describe().c_str(), stage, tries[stage] + 1);
+#ifdef DEBUG_STATISTICS
+        mapstat_report_map_rollback();
+#endif
+        _levelgen_rollback(*checkpoints[stage], progress);
+        if (!retry_seed)
+            retry_seed = get_uint64() | 1;
     }
 
 #ifdef DEBUG_MONS_SCAN
@@ -669,52 +999,6 @@ static bool _dgn_square_is_passable(const coord_def &c)
     return !(env.level_map_mask(c) & MMT_OPAQUE) && dgn_square_travel_ok(c);
 }
 
-static inline void _dgn_point_record_stub(const coord_def &) { }
-
-template <class point_record>
-static bool _dgn_fill_zone(
-    const coord_def &start, int zone,
-    point_record &record_point,
-    bool (*passable)(const coord_def &) = _dgn_square_is_passable,
-    bool (*iswanted)(const coord_def &) = nullptr)
-{
-    bool ret = false;
-    list<coord_def> points[2];
-    int cur = 0;
-
-    // No bounds checks, assuming the level has at least one layer of
-    // rock border.
-
-    for (points[cur].push_back(start); !points[cur].empty();)
-    {
-        for (const auto &c : points[cur])
-        {
-            travel_point_distance[c.x][c.y] = zone;
-
-            if (iswanted && iswanted(c))
-                ret = true;
-
-            for (adjacent_iterator ai(c); ai; ++ai)
-            {
-                const coord_def& cp = *ai;
-                if (!map_bounds(cp)
-                    || travel_point_distance[cp.x][cp.y] || !passable(cp))
-                {
-                    continue;
-                }
-
-                travel_point_distance[cp.x][cp.y] = zone;
-                record_point(cp);
-                points[!cur].push_back(cp);
-            }
-        }
-
-        points[cur].clear();
-        cur = !cur;
-    }
-    return ret;
-}
-
 static bool _is_perm_down_stair(const coord_def &c)
 {
     switch (grd(c))
@@ -822,68 +1106,34 @@ static bool _is_exit_stair(const coord_def &c)
 //
 // If fill is non-zero, it fills any disconnected regions with fill.
 //
-static int _process_disconnected_zones(int x1, int y1, int x2, int y2,
-                                       bool choose_stairless,
+static int _process_disconnected_zones(bool choose_stairless,
                                        dungeon_feature_type fill)
 {
-    memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
-    int nzones = 0;
+    dgn_zone_list zones;
+    const int nzones =
+        dgn_label_zones(travel_point_distance, zones,
+                        _dgn_square_is_passable,
+                        choose_stairless ? (at_branch_bottom() ?
+                                            _is_upwards_exit_stair :
+                                            _is_exit_stair) : nullptr);
     int ngood = 0;
-    for (int y = y1; y <= y2 ; ++y)
+    for (int zone = 1; zone <= nzones; ++zone)
     {
-        for (int x = x1; x <= x2; ++x)
-        {
-            if (!map_bounds(x, y)
-                || travel_point_distance[x][y]
-                || !_dgn_square_is_passable(coord_def(x, y)))
-            {
-                continue;
-            }
+        const dgn_zone &stats = zones[zone - 1];
 
-            const bool found_exit_stair =
-                _dgn_fill_zone(coord_def(x, y), ++nzones,
-                               _dgn_point_record_stub,
-                               _dgn_square_is_passable,
-                               choose_stairless ? (at_branch_bottom() ?
-                                                   _is_upwards_exit_stair :
-                                                   _is_exit_stair) : nullptr);
-
-            // If we want only stairless zones, screen out zones that did
-            // have stairs.
-            if (choose_stairless && found_exit_stair)
-                ++ngood;
-            else if (fill)
-            {
-                // Don't fill in areas connected to vaults.
-                // We want vaults to be accessible; if the area is disconneted
-                // from the rest of the level, this will cause the level to be
-                // vetoed later on.
-                bool veto = false;
-                vector<coord_def> coords;
-                for (int fy = y1; fy <= y2 ; ++fy)
-                {
-                    for (int fx = x1; fx <= x2; ++fx)
-                    {
-                        if (travel_point_distance[fx][fy] == nzones)
-                        {
-                            if (map_masked(coord_def(fx, fy), MMT_VAULT))
-                            {
-                                veto = true;
-                                break;
-                            }
-                            else
-                                coords.emplace_back(fx, fy);
-                        }
-                    }
-                    if (veto)
-                        break;
-                }
-                if (!veto)
-                {
-                    for (auto c : coords)
-                        _set_grd(c, fill);
-                }
-            }
+        // If we want only stairless zones, screen out zones that did
+        // have stairs.
+        if (choose_stairless && stats.wanted)
+            ++ngood;
+        // Don't fill in areas connected to vaults.
+        // We want vaults to be accessible; if the area is disconneted
+        // from the rest of the level, this will cause the level to be
+        // vetoed later on.
+        else if (fill && !stats.vault)
+        {
+            for (rectangle_iterator ri(stats.tl, stats.br); ri; ++ri)
+                if (travel_point_distance[ri->x][ri->y] == zone)
+                    _set_grd(*ri, fill);
         }
     }
 
@@ -893,8 +1143,7 @@ static int _process_disconnected_zones(int x1, int y1, int x2, int y2,
 int dgn_count_disconnected_zones(bool choose_stairless,
                                  dungeon_feature_type fill)
 {
-    return _process_disconnected_zones(0, 0, GXM-1, GYM-1, choose_stairless,
-                                       fill);
+    return _process_disconnected_zones(choose_stairless, fill);
 }
 
 static void _fixup_hell_stairs()
@@ -1731,86 +1980,76 @@ static bool _fixup_stone_stairs(bool preserve_vault_stairs)
 static bool _add_feat_if_missing(bool (*iswanted)(const coord_def &),
                                  dungeon_feature_type feat)
 {
-    memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
-    int nzones = 0;
-    for (int y = 0; y < GYM; ++y)
-        for (int x = 0; x < GXM; ++x)
-        {
-            // [ds] Use dgn_square_is_passable instead of
-            // dgn_square_travel_ok here, for we'll otherwise
-            // fail on floorless isolated pocket in vaults (like the
-            // altar surrounded by deep water), and trigger the assert
-            // downstairs.
-            const coord_def gc(x, y);
-            if (!map_bounds(x, y)
-                || travel_point_distance[x][y] // already covered previously
-                || !_dgn_square_is_passable(gc))
-            {
-                continue;
-            }
+    // [ds] Use dgn_square_is_passable instead of
+    // dgn_square_travel_ok here, for we'll otherwise
+    // fail on floorless isolated pocket in vaults (like the
+    // altar surrounded by deep water), and trigger the assert
+    // downstairs.
+    dgn_zone_list zones;
+    const int nzones = dgn_label_zones(travel_point_distance, zones,
+                                       _dgn_square_is_passable, iswanted);
+    for (int zone = 1; zone <= nzones; ++zone)
+    {
+        const dgn_zone &stats = zones[zone - 1];
+        if (stats.wanted)
+            continue;
 
-            if (_dgn_fill_zone(gc, ++nzones, _dgn_point_record_stub,
-                               _dgn_square_is_passable, iswanted))
+        bool found_feature = false;
+        for (rectangle_iterator ri(stats.tl, stats.br); ri; ++ri)
+        {
+            if (grd(*ri) == feat
+                && travel_point_distance[ri->x][ri->y] == zone)
             {
-                continue;
+                found_feature = true;
+                break;
             }
+        }
 
-            bool found_feature = false;
-            for (rectangle_iterator ri(0); ri; ++ri)
-            {
-                if (grd(*ri) == feat
-                    && travel_point_distance[ri->x][ri->y] == nzones)
-                {
-                    found_feature = true;
-                    break;
-                }
-            }
+        if (found_feature)
+            continue;
 
-            if (found_feature)
+        int i = 0;
+        while (i++ < 2000)
+        {
+            coord_def rnd(random2(GXM), random2(GYM));
+            if (grd(rnd) != DNGN_FLOOR)
                 continue;
 
-            int i = 0;
-            while (i++ < 2000)
-            {
-                coord_def rnd(random2(GXM), random2(GYM));
-                if (grd(rnd) != DNGN_FLOOR)
-                    continue;
+            if (travel_point_distance[rnd.x][rnd.y] != zone)
+                continue;
 
-                if (travel_point_distance[rnd.x][rnd.y] != nzones)
-                    continue;
+            _set_grd(rnd, feat);
+            found_feature = true;
+            break;
+        }
 
-                _set_grd(rnd, feat);
-                found_feature = true;
-                break;
-            }
+        if (found_feature)
+            continue;
 
-            if (found_feature)
+        for (rectangle_iterator ri(stats.tl, stats.br); ri; ++ri)
+        {
+            if (grd(*ri) != DNGN_FLOOR)
                 continue;
 
-            for (rectangle_iterator ri(0); ri; ++ri)
-            {
-                if (grd(*ri) != DNGN_FLOOR)
-                    continue;
-
-                if (travel_point_distance[ri->x][ri->y] != nzones)
-                    continue;
+            if (travel_point_distance[ri->x][ri->y] != zone)
+                continue;
 
-                _set_grd(*ri, feat);
-                found_feature = true;
-                break;
-            }
+            _set_grd(*ri, feat);
+            found_feature = true;
+            break;
+        }
 
-            if (found_feature)
-                continue;
+        if (found_feature)
+            continue;
 
 #ifdef DEBUG_DIAGNOSTICS
-            dump_map("debug.map", true, true);
+        dump_map("debug.map", true, true);
 #endif
-            // [ds] Too many normal cases trigger this ASSERT, including
-            // rivers that surround a stair with deep water.
-            // die("Couldn't find region.");
-            return false;
-        }
+        // [ds] Too many normal cases trigger this ASSERT, including
+        // rivers that surround a stair with deep water.
+        // die("Couldn't find region.");
+        return false;
+    }
 
     return true;
 }
@@ -2281,12 +2520,17 @@ static void _post_vault_build()
     }
 }
 
-static void _build_dungeon_level(dungeon_feature_type dest_stairs_type)
+static void _build_level_layout(levelgen_progress &progress)
 {
-    bool place_vaults = _builder_by_type();
+    progress.place_vaults = _builder_by_type();
 
+    // Labyrinths place everything themselves.
     if (player_in_branch(BRANCH_LABYRINTH))
+    {
+        _dgn_set_floor_colours();
+        progress.complete = true;
         return;
+    }
 
     if (player_in_branch(BRANCH_SLIME))
         _slime_connectivity_fixup();
@@ -2296,8 +2540,11 @@ static void _build_dungeon_level(dungeon_feature_type dest_stairs_type)
     // yet to be placed). Some items and monsters already exist.
 
     _check_doors();
+}
 
-    const unsigned nvaults = env.level_vaults.size();
+static void _build_level_vaults(levelgen_progress &progress)
+{
+    progress.nvaults = env.level_vaults.size();
 
     // Any further vaults must make sure not to disrupt level layout.
     dgn_check_connectivity = true;
@@ -2312,7 +2559,7 @@ static void _build_dungeon_level(dungeon_feature_type dest_stairs_type)
     // no guarantees, seeing this is a minivault.
     if (crawl_state.game_standard_levelgen())
     {
-        if (place_vaults)
+        if (progress.place_vaults)
         {
             // Moved branch entries to place first so there's a good
             // chance of having room for a vault
@@ -2329,7 +2576,15 @@ static void _build_dungeon_level(dungeon_feature_type dest_stairs_type)
             // Hell, Pan entries are placed this way
             _place_chance_vaults();
         }
+    }
+}
 
+// Returns false if the finished level turns out not to be usable.
+static bool _build_level_finish(const levelgen_progress &progress,
+                                dungeon_feature_type dest_stairs_type)
+{
+    if (crawl_state.game_standard_levelgen())
+    {
         // Ruination and plant clumps.
         _post_vault_build();
 
@@ -2343,7 +2598,7 @@ static void _build_dungeon_level(dungeon_feature_type dest_stairs_type)
         _place_traps();
 
         // Any vault-placement activity must happen before this check.
-        _dgn_verify_connectivity(nvaults);
+        _dgn_verify_connectivity(progress.nvaults);
 
         _builder_monsters();
 
@@ -2377,6 +2632,10 @@ static void _build_dungeon_level(dungeon_feature_type dest_stairs_type)
 
     if (player_in_hell())
         _fixup_hell_stairs();
+
+    _dgn_set_floor_colours();
+
+    return !crawl_state.game_standard_levelgen() || _valid_dungeon_level();
 }
 
 static void _dgn_set_floor_colours()
@@ -4130,7 +4389,7 @@ static const vault_placement *_build_vault_impl(const map_def *vault,
     if (!build_only && (placed_vault_orientation != MAP_ENCOMPASS || is_layout)
         && player_in_branch(BRANCH_SWAMP))
     {
-        _process_disconnected_zones(0, 0, GXM-1, GYM-1, true, DNGN_TREE);
+        _process_disconnected_zones(true, DNGN_TREE);
     }
 
     if (!make_no_exits)
@@ -6366,20 +6625,8 @@ static bool _fixup_interlevel_connectivity()
     has_down[0] = has_down[1] = has_down[2] = false;
 
     // Find up stairs and down stairs on the current level.
-    memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
-    int nzones = 0;
-    for (rectangle_iterator ri(0); ri; ++ri)
-    {
-        if (!map_bounds(ri->x, ri->y)
-            || travel_point_distance[ri->x][ri->y]
-            || !dgn_square_travel_ok(*ri))
-        {
-            continue;
-        }
-
-        _dgn_fill_zone(*ri, ++nzones, _dgn_point_record_stub,
-                       dgn_square_travel_ok, nullptr);
-    }
+    dgn_zone_list zones;
+    dgn_label_zones(travel_point_distance, zones, dgn_square_travel_ok);
 
     int max_region = 0;
     for (rectangle_iterator ri(0); ri; ++ri)
@@ -8,6 +8,9 @@
 #include "end.h"
 
 #include <cerrno>
+#ifndef TARGET_OS_WINDOWS
+# include <unistd.h>
+#endif
 
 #include "abyss.h"
 #include "chardump.h"
@@ -16,13 +19,19 @@
 #include "database.h"
 #include "describe.h"
 #include "dungeon.h"
+#include "errors.h"
 #include "god-passive.h"
 #include "hints.h"
+#include "initfile.h"
 #include "invent.h"
 #include "item-prop.h"
+#include "keylog.h"
 #include "los.h"
 #include "macro.h"
+#include "memstats.h"
 #include "message.h"
+#include "pregen.h"
+#include "profiler.h"
 #include "prompt.h"
 #include "religion.h"
 #include "state.h"
@@ -46,6 +55,7 @@ void cio_cleanup()
 // Clear some globally defined variables.
 static void _clear_globals_on_exit()
 {
+    pregen_cancel_all();
     clear_rays_on_exit();
     clear_zap_info_on_exit();
     destroy_abyss();
@@ -110,6 +120,26 @@ NORETURN void end(int exit_code, bool print_error, const char *format, ...)
     bool need_pause = true;
     disable_other_crashes();
 
+#ifndef TARGET_OS_WINDOWS
+    // A forked levelgen helper or fsim worker shares the terminal and save
+    // with its parent; leave both alone and just report failure.
+    if (crawl_state.background_levelgen || crawl_state.fsim_worker)
+        _exit(exit_code ? exit_code : 1);
+#endif
+
+    // Let a background save finish writing what was already handed to it.
+    if (you.save)
+    {
+        try
+        {
+            you.save->flush();
+        }
+        catch (ext_fail_exception &)
+        {
+            // Too late to report; the last good commit stays on disk.
+        }
+    }
+
     // Let "error" go out of scope for valgrind's sake.
     {
         string error = print_error? strerror(errno) : "";
@@ -150,6 +180,13 @@ NORETURN void end(int exit_code, bool print_error, const char *format, ...)
 #ifdef DEBUG_PROPS
         dump_prop_accesses();
 #endif
+#ifdef PROFILE_ZONES
+        if (!SysEnv.profile_file.empty())
+            prof_dump(SysEnv.profile_file);
+#endif
+        if (!SysEnv.memstats_file.empty())
+            memstats_dump(SysEnv.memstats_file);
+        keylog_finish();
 
         if (!error.empty())
         {
@@ -192,6 +229,7 @@ NORETURN void end(int exit_code, bool print_error, const char *format, ...)
 // Delete save files on game end.
 static void _delete_files()
 {
+    pregen_cancel_all();
     crawl_state.need_save = false;
     you.save->unlink();
     delete you.save;
@@ -179,10 +179,22 @@ exclude_set::exclude_set()
 {
 }
 
+exclude_set::exclude_set(const exclude_set &other)
+    : exclude_roots(other.exclude_roots)
+{
+}
+
+exclude_set &exclude_set::operator = (const exclude_set &other)
+{
+    exclude_roots = other.exclude_roots;
+    exclude_counts.reset();
+    return *this;
+}
+
 void exclude_set::clear()
 {
     exclude_roots.clear();
-    exclude_points.clear();
+    exclude_counts.reset();
 }
 
 void exclude_set::erase(const coord_def &p)
@@ -192,14 +204,14 @@ void exclude_set::erase(const coord_def &p)
     if (it == exclude_roots.end())
         return;
 
-    travel_exclude old_ex = it->second;
+    remove_exclude_points(it->second);
     exclude_roots.erase(it);
-
-    recompute_excluded_points();
 }
 
 void exclude_set::add_exclude(travel_exclude &ex)
 {
+    if (travel_exclude *old = get_exclude_root(ex.pos))
+        remove_exclude_points(*old);
     add_exclude_points(ex);
     exclude_roots[ex.pos] = ex;
 }
@@ -212,40 +224,77 @@ void exclude_set::add_exclude(const coord_def &p, int radius,
     add_exclude(ex);
 }
 
+// Work out which cells ex covers, and count them in the grid if there is
+// one yet.
 void exclude_set::add_exclude_points(travel_exclude& ex)
 {
+    ex.points.clear();
     if (ex.radius == 0)
+        ex.points.push_back(ex.pos);
+    else
     {
-        exclude_points.insert(ex.pos);
-        return;
+        if (!ex.uptodate)
+            ex.set_los();
+        else
+            ex.los.update();
+
+        for (radius_iterator ri(ex.pos, ex.radius, C_SQUARE); ri; ++ri)
+            if (ex.affects(*ri))
+                ex.points.push_back(*ri);
     }
 
-    if (!ex.uptodate)
-        ex.set_los();
-    else
-        ex.los.update();
+    if (exclude_counts)
+        for (const coord_def &c : ex.points)
+            (*exclude_counts)(c)++;
+}
+
+void exclude_set::remove_exclude_points(travel_exclude& ex)
+{
+    if (exclude_counts)
+    {
+        for (const coord_def &c : ex.points)
+        {
+            uint16_t &count = (*exclude_counts)(c);
+            ASSERT(count > 0);
+            count--;
+        }
+    }
+    ex.points.clear();
+}
 
-    for (radius_iterator ri(ex.pos, ex.radius, C_SQUARE); ri; ++ri)
-        if (ex.affects(*ri))
-            exclude_points.insert(*ri);
+const exclude_set::count_grid &exclude_set::counts() const
+{
+    if (!exclude_counts)
+    {
+        exclude_counts.reset(new count_grid);
+        exclude_counts->init(0);
+        for (const auto &entry : exclude_roots)
+            for (const coord_def &c : entry.second.points)
+                (*exclude_counts)(c)++;
+    }
+    return *exclude_counts;
 }
 
+// Redo the points of just those exclusions whose LOS is out of date; the
+// coverage counts let the others' points stay where they are.
 void exclude_set::update_excluded_points(bool recompute_los)
 {
     for (iterator it = exclude_roots.begin(); it != exclude_roots.end(); ++it)
     {
         travel_exclude &ex = it->second;
-        if (!ex.uptodate)
-        {
-            recompute_excluded_points(recompute_los);
-            return;
-        }
+        if (ex.uptodate)
+            continue;
+
+        remove_exclude_points(ex);
+        if (recompute_los)
+            ex.set_los();
+        add_exclude_points(ex);
     }
 }
 
 void exclude_set::recompute_excluded_points(bool recompute_los)
 {
-    exclude_points.clear();
+    exclude_counts.reset();
     for (iterator it = exclude_roots.begin(); it != exclude_roots.end(); ++it)
     {
         travel_exclude &ex = it->second;
@@ -257,7 +306,7 @@ void exclude_set::recompute_excluded_points(bool recompute_los)
 
 bool exclude_set::is_excluded(const coord_def &p) const
 {
-    return exclude_points.count(p);
+    return !exclude_roots.empty() && map_bounds(p) && counts()(p);
 }
 
 bool exclude_set::is_exclude_root(const coord_def &p) const
@@ -486,7 +535,7 @@ void set_exclude(const coord_def &p, int radius, bool autoexcl, bool vaultexcl,
 
         exc->radius   = radius;
         exc->uptodate = false;
-        curr_excludes.recompute_excluded_points();
+        curr_excludes.update_excluded_points();
     }
     else
     {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "fixedarray.h"
 #include "los-def.h"
 
 void set_auto_exclude(const monster* mon);
@@ -44,6 +45,8 @@ public:
 private:
     void set_los();
 
+    vector<coord_def> points;   // Cells counted in the exclude_set's grid.
+
     friend class exclude_set;
 };
 
@@ -51,6 +54,8 @@ class exclude_set
 {
 public:
     exclude_set();
+    exclude_set(const exclude_set &other);
+    exclude_set &operator = (const exclude_set &other);
 
     typedef map<coord_def, travel_exclude> exclmap;
     typedef exclmap::iterator       iterator;
@@ -84,13 +89,18 @@ public:
     iterator  end();
 
 private:
-    typedef set<coord_def> exclset;
+    typedef FixedArray<uint16_t, GXM, GYM> count_grid;
 
     exclmap exclude_roots;
-    exclset exclude_points;
+    // For each cell, how many exclusions cover it. Built from the roots'
+    // points when first needed, and not copied, so that the travel cache's
+    // copies of every level's exclusions don't each carry a grid.
+    mutable unique_ptr<count_grid> exclude_counts;
 
 private:
     void add_exclude_points(travel_exclude& ex);
+    void remove_exclude_points(travel_exclude& ex);
+    const count_grid &counts() const;
 };
 
 extern exclude_set curr_excludes; // in travel.cc
@@ -663,6 +663,9 @@ public:
     bool is_mundane() const;
 
 private:
+    string cached_name_aux(description_level_type desc, bool terse,
+                           bool ident, bool with_inscription,
+                           iflags_t ignore_flags) const;
     string name_aux(description_level_type desc, bool terse, bool ident,
                     bool with_inscription, iflags_t ignore_flags) const;
 
@@ -826,6 +829,7 @@ public:
     vector<map_marker*> get_all(map_marker_type type = MAT_ANY);
     vector<map_marker*> get_all(const string &key, const string &val = "");
     vector<map_marker*> get_markers_at(const coord_def &c);
+    vector<map_marker*> get_property_markers_by_row() const;
     string property_at(const coord_def &c, map_marker_type type,
                        const string &key);
     string property_at(const coord_def &c, map_marker_type type,
@@ -841,11 +845,18 @@ private:
     typedef pair<coord_def, map_marker *> dgn_pos_marker;
 
     void init_from(const map_markers &);
+    void link_marker(map_marker *);
     void unlink_marker(const map_marker *);
     void check_empty();
 
 private:
+    // All markers, and the same markers bucketed by type and (for those
+    // that have any) by having properties. Every map is kept in the same
+    // order, so lookups by type or property find the markers that a scan
+    // of all of them would, in the same order.
     dgn_marker_map markers;
+    FixedVector<dgn_marker_map, NUM_MAP_MARKER_TYPES> markers_by_type;
+    dgn_marker_map property_markers;
     bool have_inactive_markers;
 };
 
@@ -61,6 +61,8 @@
 #include "notes.h"
 #include "output.h"
 #include "place.h"
+#include "pregen.h"
+#include "profiler.h"
 #include "prompt.h"
 #include "spl-summoning.h"
 #include "stash.h"  // for fedhas_rot_all_corpses
@@ -622,6 +624,224 @@ static void _fill_player_doll(player_save_info &p, package *save)
 }
 #endif
 
+#ifndef DISABLE_SAVEGAME_LISTS
+// Summaries of every save in a directory, so that listing them doesn't
+// mean opening each one. An entry is trusted only while its save's mtime
+// and size are unchanged.
+#define SAVE_INDEX "saves.idx"
+
+struct save_index_entry
+{
+    time_t mtime;
+    int64_t size;
+    bool doll_scanned;
+    player_save_info info;
+};
+
+typedef map<string, save_index_entry> save_index;
+
+static bool _save_file_stat(const string &path, time_t &mtime, int64_t &size)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st))
+        return false;
+
+    mtime = st.st_mtime;
+    size  = st.st_size;
+    return true;
+}
+
+static void _marshall_save_index_entry(writer &th,
+                                       const save_index_entry &entry)
+{
+    const player_save_info &p = entry.info;
+    marshallSigned(th, entry.mtime);
+    marshallSigned(th, entry.size);
+    marshallString(th, p.name);
+    marshallInt(th, p.experience);
+    marshallInt(th, p.experience_level);
+    marshallBoolean(th, p.wizard);
+    marshallShort(th, p.species);
+    marshallString(th, p.species_name);
+    marshallString(th, p.class_name);
+    marshallShort(th, p.religion);
+    marshallString(th, p.god_name);
+    marshallString(th, p.jiyva_second_name);
+    marshallByte(th, p.saved_game_type);
+    marshallBoolean(th, p.save_loadable);
+
+    // Console and tiles builds can share a save directory; the doll is
+    // written as a plain list so that either can read the other's index.
+    marshallBoolean(th, entry.doll_scanned);
+#ifdef USE_TILE
+    marshallUnsigned(th, TILEP_PART_MAX);
+    for (int i = 0; i < TILEP_PART_MAX; ++i)
+        marshallUnsigned(th, p.doll.parts[i]);
+#else
+    marshallUnsigned(th, 0);
+#endif
+}
+
+static void _unmarshall_save_index_entry(reader &th, save_index_entry &entry)
+{
+    player_save_info &p = entry.info;
+    entry.mtime          = unmarshallSigned(th);
+    entry.size           = unmarshallSigned(th);
+    p.name               = unmarshallString(th);
+    p.experience         = unmarshallInt(th);
+    p.experience_level   = unmarshallInt(th);
+    p.wizard             = unmarshallBoolean(th);
+    p.species            = static_cast<species_type>(unmarshallShort(th));
+    p.species_name       = unmarshallString(th);
+    p.class_name         = unmarshallString(th);
+    p.religion           = static_cast<god_type>(unmarshallShort(th));
+    p.god_name           = unmarshallString(th);
+    p.jiyva_second_name  = unmarshallString(th);
+    p.saved_game_type    = static_cast<game_type>(unmarshallByte(th));
+    p.save_loadable      = unmarshallBoolean(th);
+
+    entry.doll_scanned = unmarshallBoolean(th);
+    const uint64_t parts = unmarshallUnsigned(th);
+#ifdef USE_TILE
+    if (parts != TILEP_PART_MAX)
+        entry.doll_scanned = false;
+#endif
+    for (uint64_t i = 0; i < parts; ++i)
+    {
+        const uint64_t tile = unmarshallUnsigned(th);
+#ifdef USE_TILE
+        if (parts == TILEP_PART_MAX)
+            p.doll.parts[i] = tile;
+#else
+        UNUSED(tile);
+#endif
+    }
+}
+
+static string _save_index_lock()
+{
+    return _get_savedir_path(SAVE_INDEX ".lk");
+}
+
+/**
+ * Read the save index of the current save directory. Writers take the
+ * lock exclusively, so a reader sees either all of an index or none of it;
+ * a missing, foreign or damaged index just reads as empty.
+ */
+static save_index _read_save_index()
+{
+    save_index index;
+
+    file_lock lock(_save_index_lock(), "rb", false);
+    FILE *fp = fopen_u(_get_savedir_path(SAVE_INDEX).c_str(), "rb");
+    if (!fp)
+        return index;
+
+    try
+    {
+        reader inf(fp);
+        inf.set_safe_read(true);
+        if (unmarshallUByte(inf) == TAG_MAJOR_VERSION
+            && unmarshallUByte(inf) == TAG_MINOR_VERSION
+            && unmarshallString(inf) == Version::Long)
+        {
+            for (int count = unmarshallInt(inf); count > 0; --count)
+            {
+                const string filename = unmarshallString(inf);
+                _unmarshall_save_index_entry(inf, index[filename]);
+            }
+        }
+    }
+    catch (short_read_exception &E)
+    {
+        index.clear();
+    }
+    fclose(fp);
+    return index;
+}
+
+static void _write_save_index(const save_index &index)
+{
+    file_lock lock(_save_index_lock(), "wb", false);
+    const string path = _get_savedir_path(SAVE_INDEX);
+    FILE *fp = fopen_u(path.c_str(), "wb");
+    if (!fp)
+        return;
+
+    {
+        writer outf(path, fp, true);
+        marshallUByte(outf, TAG_MAJOR_VERSION);
+        marshallUByte(outf, TAG_MINOR_VERSION);
+        marshallString(outf, Version::Long);
+        marshallInt(outf, index.size());
+        for (const auto &entry : index)
+        {
+            marshallString(outf, entry.first);
+            _marshall_save_index_entry(outf, entry.second);
+        }
+    }
+
+    const bool written = !ferror(fp);
+    fclose(fp);
+    // Better no index than a truncated one.
+    if (!written)
+        unlink_u(path.c_str());
+}
+
+/**
+ * Make sure index has an up-to-date entry for the named save, reading the
+ * save itself only if the old index's entry (if any) is stale.
+ *
+ * @return whether the save had to be read.
+ */
+static bool _index_save_file(const string &filename, const save_index &old,
+                             save_index &index)
+{
+    const string path = _get_savedir_path(filename);
+    time_t mtime;
+    int64_t size;
+    if (!_save_file_stat(path, mtime, size))
+        return false;
+
+#ifdef USE_TILE
+    const bool want_doll = Options.tile_menu_icons;
+#else
+    const bool want_doll = false;
+#endif
+
+    auto known = old.find(filename);
+    if (known != old.end() && known->second.mtime == mtime
+        && known->second.size == size
+        && (known->second.doll_scanned || !want_doll))
+    {
+        index[filename] = known->second;
+        return false;
+    }
+
+    save_index_entry &entry = index[filename];
+    entry.mtime = mtime;
+    entry.size = size;
+    entry.doll_scanned = want_doll;
+    // A save we can't read stays in the index with no name, so that it isn't
+    // retried until it changes.
+    try
+    {
+        package save(path.c_str(), false);
+        entry.info = _read_character_info(&save);
+#ifdef USE_TILE
+        if (want_doll && !entry.info.name.empty() && save.has_chunk("tdl"))
+            _fill_player_doll(entry.info, &save);
+#endif
+    }
+    catch (ext_fail_exception &E)
+    {
+        dprf("%s: %s", filename.c_str(), E.what());
+        entry.info = player_save_info();
+    }
+    return true;
+}
+#endif
+
 /*
  * Returns a list of the names of characters that are already saved for the
  * current user.
@@ -635,42 +855,48 @@ static vector<player_save_info> _find_saved_characters()
         return chars;
 
 #ifndef DISABLE_SAVEGAME_LISTS
-    string searchpath = _get_savefile_directory();
-
-    if (searchpath.empty())
-        searchpath = ".";
+    const save_index old_index = _read_save_index();
+    save_index index;
+    bool changed = false;
 
-    for (const string &filename : get_dir_files(searchpath))
+    for (const string &filename : get_dir_files(_get_savefile_directory()))
     {
-        if (is_save_file_name(filename))
+        if (!is_save_file_name(filename))
+            continue;
+
+        if (_index_save_file(filename, old_index, index))
+            changed = true;
+
+        auto entry = index.find(filename);
+        if (entry != index.end() && !entry->second.info.name.empty())
         {
-            try
-            {
-                package save(_get_savedir_path(filename).c_str(), false);
-                player_save_info p = _read_character_info(&save);
-                if (!p.name.empty())
-                {
-                    p.filename = filename;
-#ifdef USE_TILE
-                    if (Options.tile_menu_icons && save.has_chunk("tdl"))
-                        _fill_player_doll(p, &save);
-#endif
-                    chars.push_back(p);
-                }
-            }
-            catch (ext_fail_exception &E)
-            {
-                dprf("%s: %s", filename.c_str(), E.what());
-            }
+            chars.push_back(entry->second.info);
+            chars.back().filename = filename;
         }
-
     }
 
+    // Also drops the entries of saves that are gone.
+    if (changed || index.size() != old_index.size())
+        _write_save_index(index);
+
     sort(chars.begin(), chars.end());
 #endif // !DISABLE_SAVEGAME_LISTS
     return chars;
 }
 
+// Bring this game's entry in the save index up to date.
+static void _update_save_index()
+{
+#ifndef DISABLE_SAVEGAME_LISTS
+    if (Options.no_save)
+        return;
+
+    save_index index = _read_save_index();
+    if (_index_save_file(get_save_filename(you.your_name), index, index))
+        _write_save_index(index);
+#endif
+}
+
 vector<player_save_info> find_all_saved_characters()
 {
     set<string> dirs;
@@ -1126,6 +1352,32 @@ static bool _leave_level(dungeon_feature_type stair_taken,
 }
 
 
+/**
+ * Wipe the level state in env and build the current level from scratch.
+ *
+ * Levels that can be pregenerated are built from their own RNG stream, so
+ * they come out the same whether they are built here or in a helper.
+ *
+ * @param stair_type    The stair the player is expected to arrive by.
+ * @return              Whether builder() succeeded.
+ */
+bool generate_new_level(dungeon_feature_type stair_type)
+{
+    tile_init_default_flavour();
+    tile_clear_flavour();
+    env.tile_names.clear();
+    _clear_env_map();
+
+    const level_id here = level_id::current();
+    if (pregen_eligible(here))
+    {
+        rng_subgenerator levelgen_rng(pregen_game_seed(),
+                                      pregen_level_seed(here));
+        return builder(true, stair_type);
+    }
+    return builder(true, stair_type);
+}
+
 /**
  * Generate a new level.
  *
@@ -1150,10 +1402,6 @@ static void _make_level(dungeon_feature_type stair_taken,
         you.chapter = CHAPTER_ORB_HUNTING;
     }
 
-    tile_init_default_flavour();
-    tile_clear_flavour();
-    env.tile_names.clear();
-
     // XXX: This is ugly.
     bool dummy;
     dungeon_feature_type stair_type = static_cast<dungeon_feature_type>(
@@ -1161,9 +1409,11 @@ static void _make_level(dungeon_feature_type stair_taken,
                              static_cast<dungeon_feature_type>(stair_taken),
                              dummy));
 
-    _clear_env_map();
-    builder(true, stair_type);
+    if (!pregen_restore_level(level_id::current()))
+        generate_new_level(stair_type);
 
+    // Seeded games, including every -record and -replay, are meant to be
+    // reproducible, and the bones files on disk aren't.
     if (!crawl_state.game_is_tutorial()
         && !Options.seed
         && !player_in_branch(BRANCH_ABYSS)
@@ -1551,6 +1801,10 @@ bool load_level(dungeon_feature_type stair_taken, load_mode_type load_mode,
     }
 #endif
 
+    // Now that arrival has settled, start on the levels next to this one.
+    if (make_changes)
+        pregen_schedule_adjacent();
+
     return just_created_level;
 }
 
@@ -1619,6 +1873,7 @@ static void _save_game_base()
 // complain.
 static void _save_game_exit()
 {
+    pregen_cancel_all();
     clua.save_persist();
 
     // Prompt for saving macros.
@@ -1644,10 +1899,14 @@ static void _save_game_exit()
 
     delete you.save;
     you.save = 0;
+
+    // Spare the next start menu from reading this save again.
+    _update_save_index();
 }
 
 void save_game(bool leave_game, const char *farewellmsg)
 {
+    PROF_ZONE("save_game");
     unwind_bool saving_game(crawl_state.saving_game, true);
 
 
@@ -1930,6 +2189,8 @@ static bool _restore_game(const string& filename)
         }
     }
 
+    you.save->enable_async();
+
     _restore_tagged_chunk(you.save, "you", TAG_YOU, "Save data is invalid.");
 
     const int minorVersion = crawl_state.minor_version;
@@ -79,6 +79,7 @@ class level_id;
 
 void trackers_init_new_level(bool transit);
 
+bool generate_new_level(dungeon_feature_type stair_type);
 bool load_level(dungeon_feature_type stair_taken, load_mode_type load_mode,
                 const level_id& old_level);
 void delete_level(const level_id &level);
@@ -19,6 +19,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <sys/stat.h>
 #ifndef TARGET_COMPILER_VC
 #include <unistd.h>
 #endif
@@ -48,6 +49,8 @@
 #include "state.h"
 #include "status.h"
 #include "stringutil.h"
+#include "syscalls.h"
+#include "tags.h"
 #ifdef USE_TILE
  #include "tilepick.h"
 #endif
@@ -56,6 +59,7 @@
 #endif
 #include "unwind.h"
 #include "version.h"
+#include "xlog-query.h"
 
 #define SCORE_VERSION "0.1"
 
@@ -91,87 +95,252 @@ static string _log_file_name()
     return Options.shared_dir + "logfile" + crawl_state.game_type_qualifier();
 }
 
-int hiscores_new_entry(const scorefile_entry &ne)
-{
-    unwind_bool score_update(crawl_state.updating_scores, true);
+/*
+ * An index file next to the score file keeps the list in order: for each
+ * entry, its score and where its line is. Ranking a new entry or showing
+ * part of the list then needs no parsing at all beyond the lines actually
+ * shown.
+ *
+ * The score file itself stays in the usual format, sorted and no longer
+ * than SCORE_FILE_ENTRIES, for anything else that reads it. A new high
+ * score rewrites it from the lines as they are, in the order the index
+ * gives, so that needs no parsing either. Everything is guarded by the
+ * score file's lock. The index records the size it was made for, so if
+ * the score file was changed behind its back (say by an older version),
+ * or we crashed between writing the two, the index is simply rebuilt.
+ */
+#define SCORE_INDEX_VERSION 3
 
-    FILE *scores;
-    int i, total_entries;
-    bool inserted = false;
-    int newest_entry = -1;
+struct score_ref
+{
+    int64_t score;
+    uint32_t offset;
+    uint32_t length;
+};
 
-    // open highscore file (reading) -- nullptr is fatal!
-    //
-    // Opening as a+ instead of r+ to force an exclusive lock (see
-    // hs_open) and to create the file if it's not there already.
-    scores = _hs_open("a+", _score_file_name());
-    if (scores == nullptr)
-        end(1, true, "failed to open score file for writing");
+struct score_index
+{
+    int64_t scores_size;
+    int64_t scores_mtime;
+    vector<score_ref> refs; // best first
+};
 
-    // we're at the end of the file, seek back to beginning.
-    fseek(scores, 0, SEEK_SET);
+static string _score_index_name()
+{
+    return _score_file_name() + ".idx";
+}
 
-    // read highscore file, inserting new entry at appropriate point,
-    for (i = 0; i < SCORE_FILE_ENTRIES; i++)
+static void _stat_file(FILE *f, int64_t &size, int64_t &mtime)
+{
+    struct stat st;
+    if (fstat(fileno(f), &st))
+        size = mtime = -1;
+    else
     {
-        hs_list[i].reset(new scorefile_entry);
-        if (_hs_read(scores, *hs_list[i]) == false)
-            break;
+        size  = st.st_size;
+        mtime = st.st_mtime;
+    }
+}
 
-        // compare points..
-        if (!inserted && ne.get_score() >= hs_list[i]->get_score())
+static bool _read_score_index(FILE *scores, score_index &idx)
+{
+    FILE *fp = fopen_u(_score_index_name().c_str(), "rb");
+    if (!fp)
+        return false;
+
+    int64_t size, mtime;
+    _stat_file(scores, size, mtime);
+
+    bool ok = false;
+    try
+    {
+        reader inf(fp);
+        inf.set_safe_read(true);
+        ok = unmarshallUByte(inf) == SCORE_INDEX_VERSION;
+        if (ok)
+        {
+            idx.scores_size  = unmarshallSigned(inf);
+            idx.scores_mtime = unmarshallSigned(inf);
+            ok = idx.scores_size == size && idx.scores_mtime == mtime;
+        }
+        if (ok)
         {
-            newest_entry = i;           // for later printing
-            inserted = true;
-            // copy read entry to i+1th position
-            // Fixed a nasty overflow bug here -- Sharp
-            if (i+1 < SCORE_FILE_ENTRIES)
+            idx.refs.resize(unmarshallUnsigned(inf));
+            for (score_ref &ref : idx.refs)
             {
-                hs_list[i + 1] = move(hs_list[i]);
-                hs_list[i].reset(new scorefile_entry(ne));
-                i++;
+                ref.score  = unmarshallSigned(inf);
+                ref.offset = unmarshallUnsigned(inf);
+                ref.length = unmarshallUnsigned(inf);
             }
-            else
-                *hs_list[i] = ne; // copy new entry to current position
         }
     }
+    catch (short_read_exception &E)
+    {
+        ok = false;
+    }
+    fclose(fp);
+
+    if (!ok)
+        idx.refs.clear();
+    return ok;
+}
+
+static void _write_score_index(FILE *scores, score_index &idx)
+{
+    _stat_file(scores, idx.scores_size, idx.scores_mtime);
+
+    // Written aside and renamed into place, so that a crash leaves either
+    // index whole.
+    const string file = _score_index_name();
+    const string tmp = file + ".tmp";
+    FILE *fp = fopen_replace(tmp.c_str());
+    if (!fp)
+        return;
 
-    // special case: lowest score, with room
-    if (!inserted && i < SCORE_FILE_ENTRIES)
     {
-        newest_entry = i;
-        inserted = true;
-        // copy new entry
-        hs_list[i].reset(new scorefile_entry(ne));
-        i++;
+        writer outf(tmp, fp, true);
+        marshallUByte(outf, SCORE_INDEX_VERSION);
+        marshallSigned(outf, idx.scores_size);
+        marshallSigned(outf, idx.scores_mtime);
+        marshallUnsigned(outf, idx.refs.size());
+        for (const score_ref &ref : idx.refs)
+        {
+            marshallSigned(outf, ref.score);
+            marshallUnsigned(outf, ref.offset);
+            marshallUnsigned(outf, ref.length);
+        }
     }
 
-    // If we've still not inserted it, it's not a highscore.
-    if (!inserted)
+    const bool written = !ferror(fp);
+    fclose(fp);
+    if (!written || rename_u(tmp.c_str(), file.c_str()))
+        unlink_u(tmp.c_str());
+}
+
+// Where a new entry with this score goes: ahead of any equal scores.
+static int _score_rank(const score_index &idx, int64_t score)
+{
+    return lower_bound(idx.refs.begin(), idx.refs.end(), score,
+                       [](const score_ref &ref, int64_t s)
+                       { return ref.score > s; })
+           - idx.refs.begin();
+}
+
+// Read the next line of f, noting where it was.
+static bool _hs_read_ref(FILE *f, scorefile_entry &se, score_ref &ref)
+{
+    const long start = ftell(f);
+    if (start < 0 || !_hs_read(f, se))
+        return false;
+
+    ref.score = se.get_score();
+    ref.offset = start;
+    ref.length = ftell(f) - start;
+    return true;
+}
+
+// The slow way: parse the score file.
+static void _rebuild_score_index(FILE *scores, score_index &idx)
+{
+    idx.refs.clear();
+
+    scorefile_entry se;
+    score_ref ref;
+    rewind(scores);
+    while ((int) idx.refs.size() < SCORE_FILE_ENTRIES
+           && _hs_read_ref(scores, se, ref))
     {
-        _hs_close(scores, _score_file_name());
-        return -1;
+        idx.refs.push_back(ref);
     }
+}
 
-    total_entries = i;
+static void _load_score_index(FILE *scores, score_index &idx)
+{
+    if (!_read_score_index(scores, idx))
+        _rebuild_score_index(scores, idx);
+}
 
-    // The old code closed and reopened the score file, leading to a
-    // race condition where one Crawl process could overwrite the
-    // other's highscore. Now we truncate and rewrite the file without
-    // closing it.
+static string _score_line(FILE *scores, const score_ref &ref)
+{
+    string line(ref.length, '\0');
+    if (fseek(scores, ref.offset, SEEK_SET)
+        || fread(&line[0], 1, ref.length, scores) != ref.length)
+    {
+        return "";
+    }
+    return line;
+}
+
+static bool _hs_read_indexed(FILE *scores, const score_ref &ref,
+                             scorefile_entry &dest)
+{
+    const string line = _score_line(scores, ref);
+    dest.reset();
+    return !line.empty() && dest.parse(line);
+}
+
+// Write the list back out, in order, and index it.
+static void _write_scores(FILE *scores, const vector<string> &lines,
+                          score_index &idx)
+{
+    // As before, truncate and rewrite the file without closing it (and so
+    // without losing the lock).
     if (ftruncate(fileno(scores), 0))
         end(1, true, "unable to truncate scorefile");
-
     rewind(scores);
 
-    // write scorefile entries.
-    for (i = 0; i < total_entries; i++)
+    uint32_t offset = 0;
+    for (unsigned int i = 0; i < lines.size(); ++i)
     {
-        _hs_write(scores, *hs_list[i]);
-        hs_list[i].reset(nullptr);
+        fputs(lines[i].c_str(), scores);
+        idx.refs[i].offset = offset;
+        idx.refs[i].length = lines[i].length();
+        offset += lines[i].length();
     }
+    if (fflush(scores))
+        end(1, true, "failed to write score file");
+
+    _write_score_index(scores, idx);
+}
+
+int hiscores_new_entry(const scorefile_entry &ne)
+{
+    unwind_bool score_update(crawl_state.updating_scores, true);
+
+    // Opening as a+ instead of r+ to force an exclusive lock (see
+    // hs_open) and to create the file if it's not there already.
+    FILE *scores = _hs_open("a+", _score_file_name());
+    if (scores == nullptr)
+        end(1, true, "failed to open score file for writing");
+
+    score_index idx;
+    _load_score_index(scores, idx);
+
+    const int newest_entry = _score_rank(idx, ne.get_score());
+    // If it doesn't make the list, it's not a highscore.
+    if (newest_entry >= SCORE_FILE_ENTRIES)
+    {
+        _hs_close(scores, _score_file_name());
+        return -1;
+    }
+
+    // The other entries are copied over as the lines they are.
+    vector<string> lines;
+    for (const score_ref &ref : idx.refs)
+        lines.push_back(_score_line(scores, ref));
+
+    score_ref ref;
+    ref.score = ne.get_score();
+    idx.refs.insert(idx.refs.begin() + newest_entry, ref);
+    lines.insert(lines.begin() + newest_entry, ne.raw_string());
+    if ((int) lines.size() > SCORE_FILE_ENTRIES)
+    {
+        idx.refs.resize(SCORE_FILE_ENTRIES);
+        lines.resize(SCORE_FILE_ENTRIES);
+    }
+
+    _write_scores(scores, lines, idx);
 
-    // close scorefile.
     _hs_close(scores, _score_file_name());
     return newest_entry;
 }
@@ -223,6 +392,11 @@ void hiscores_print_all(int display_count, int format)
 {
     unwind_bool scorefile_display(crawl_state.updating_scores, true);
 
+    xlog_query query;
+    string err;
+    if (!query.parse(SysEnv.score_query, err))
+        end(1, false, "%s", err.c_str());
+
     FILE *scores = _hs_open("r", _score_file_name());
     if (scores == nullptr)
     {
@@ -231,16 +405,53 @@ void hiscores_print_all(int display_count, int format)
         return;
     }
 
-    for (int entry = 0; display_count <= 0 || entry < display_count; ++entry)
+    int entry = 0;
+    auto print = [&](const string &line)
     {
         scorefile_entry se;
-        if (!_hs_read(scores, se))
-            break;
+        if (!se.parse(line))
+            return;
 
         if (format == -1)
             printf("%s", se.raw_string().c_str());
         else
             _hiscores_print_entry(se, entry, format, printf);
+        entry++;
+    };
+
+    // Any other score file, logfile or standard input may be huge: scan it
+    // in place, listing the matching entries in file order as always.
+    if (!SysEnv.scorefile.empty())
+    {
+        xlog_file file;
+        if (!file.open(scores))
+            end(1, true, "Can't read %s", _score_file_name().c_str());
+
+        for (const xlog_line &line : query.select(file, display_count))
+            print(string(line.start, line.len) + "\n");
+
+        _hs_close(scores, _score_file_name());
+        return;
+    }
+
+    score_index idx;
+    _load_score_index(scores, idx);
+
+    for (const score_ref &ref : idx.refs)
+    {
+        if (display_count > 0 && entry >= display_count)
+            break;
+
+        const string line = _score_line(scores, ref);
+        if (line.empty())
+            break;
+
+        // The last line of a hand-edited file may have no newline.
+        xlog_line xl = { line.data(), line.length() };
+        if (line.back() == '\n')
+            xl.len--;
+        if (query.matches(xl))
+            print(line);
     }
 
     _hs_close(scores, _score_file_name());
@@ -263,19 +474,9 @@ void hiscores_print_list(int display_count, int format, int newest_entry)
     if (scores == nullptr)
         return;
 
-    // read highscore file
-    for (i = 0; i < SCORE_FILE_ENTRIES; i++)
-    {
-        hs_list[i].reset(new scorefile_entry);
-        if (_hs_read(scores, *hs_list[i]) == false)
-            break;
-    }
-    total_entries = i;
-
-    // close off
-    _hs_close(scores, _score_file_name());
-
-    textcolour(LIGHTGREY);
+    score_index idx;
+    _load_score_index(scores, idx);
+    total_entries = idx.refs.size();
 
     int start = newest_entry - display_count / 2;
 
@@ -287,6 +488,22 @@ void hiscores_print_list(int display_count, int format, int newest_entry)
 
     const int finish = start + display_count;
 
+    // Only the entries shown need to be read.
+    for (i = start; i < finish && i < total_entries; i++)
+    {
+        hs_list[i].reset(new scorefile_entry);
+        if (!_hs_read_indexed(scores, idx.refs[i], *hs_list[i]))
+        {
+            total_entries = i;
+            break;
+        }
+    }
+
+    // close off
+    _hs_close(scores, _score_file_name());
+
+    textcolour(LIGHTGREY);
+
     for (i = start; i < finish && i < total_entries; i++)
     {
         // check for recently added entry
@@ -327,12 +544,14 @@ static void _construct_hiscore_table(MenuScroller* scroller)
     if (scores == nullptr)
         return;
 
+    score_index idx;
+    _load_score_index(scores, idx);
+
     int i;
-    // read highscore file
-    for (i = 0; i < SCORE_FILE_ENTRIES; i++)
+    for (i = 0; i < (int) idx.refs.size(); i++)
     {
         hs_list[i].reset(new scorefile_entry);
-        if (_hs_read(scores, *hs_list[i]) == false)
+        if (!_hs_read_indexed(scores, idx.refs[i], *hs_list[i]))
             break;
     }
 
@@ -36,6 +36,7 @@
 #include "item-prop.h"
 #include "items.h"
 #include "jobs.h"
+#include "keylog.h"
 #include "kills.h"
 #include "libutil.h"
 #include "macro.h"
@@ -206,6 +207,7 @@ const vector<GameOption*> game_options::build_options_list()
         new BoolGameOption(SIMPLE_NAME(explore_auto_rest), false),
         new BoolGameOption(SIMPLE_NAME(travel_key_stop), true),
         new BoolGameOption(SIMPLE_NAME(dump_on_save), true),
+        new BoolGameOption(SIMPLE_NAME(pregen_levels), false),
         new BoolGameOption(SIMPLE_NAME(rest_wait_both), false),
         new BoolGameOption(SIMPLE_NAME(cloud_status), !is_tiles()),
         new BoolGameOption(SIMPLE_NAME(darken_beyond_range), true),
@@ -3722,6 +3724,7 @@ enum commandline_option_type
     CLO_TSCORES,
     CLO_VSCORES,
     CLO_SCOREFILE,
+    CLO_SCORE_QUERY,
     CLO_MORGUE,
     CLO_MACRO,
     CLO_MAPSTAT,
@@ -3731,6 +3734,15 @@ enum commandline_option_type
     CLO_DUMP_MAPS,
     CLO_TEST,
     CLO_SCRIPT,
+    CLO_BENCH,
+    CLO_BENCH_BASELINE,
+    CLO_BENCH_THRESHOLD,
+    CLO_FSIM,
+    CLO_FSIM_JOBS,
+    CLO_PROFILE,
+    CLO_MEMSTATS,
+    CLO_RECORD,
+    CLO_REPLAY,
     CLO_BUILDDB,
     CLO_HELP,
     CLO_VERSION,
@@ -3763,9 +3775,11 @@ enum commandline_option_type
 static const char *cmd_ops[] =
 {
     "scores", "name", "species", "background", "dir", "rc",
-    "rcdir", "tscores", "vscores", "scorefile", "morgue", "macro",
-    "mapstat", "objstat", "iters", "arena", "dump-maps", "test", "script",
-    "builddb", "help", "version", "seed", "save-version", "sprint",
+    "rcdir", "tscores", "vscores", "scorefile", "score-query", "morgue",
+    "macro", "mapstat", "objstat", "iters", "arena", "dump-maps", "test",
+    "script", "bench", "bench-baseline", "bench-threshold", "fsim",
+    "fsim-jobs", "profile", "memstats", "record", "replay", "builddb",
+    "help", "version", "seed", "save-version", "sprint",
     "extra-opt-first", "extra-opt-last", "sprint-map", "edit-save",
     "print-charset", "tutorial", "wizard", "explore", "no-save",
     "gdb", "no-gdb", "nogdb", "throttle", "no-throttle",
@@ -4426,6 +4440,111 @@ bool parse_args(int argc, char **argv, bool rc_only)
                     "-script must specify comma-separated script names");
             break;
 
+        case CLO_BENCH:
+            crawl_state.bench = true;
+#ifdef USE_TILE_LOCAL
+            crawl_state.tiles_disabled = true;
+#endif
+            if (next_is_param)
+            {
+                crawl_state.benches_selected = split_string(",", next_arg);
+                nextUsed = true;
+            }
+            break;
+
+        case CLO_BENCH_BASELINE:
+            if (!next_is_param)
+                return false;
+            crawl_state.bench_baseline = next_arg;
+            nextUsed = true;
+            break;
+
+        case CLO_BENCH_THRESHOLD:
+            if (!next_is_param || !isadigit(*next_arg))
+            {
+                fprintf(stderr, "Integer argument required for -%s\n", arg);
+                end(1);
+            }
+            crawl_state.bench_threshold = atoi(next_arg);
+            nextUsed = true;
+            break;
+
+        case CLO_FSIM:
+#ifdef WIZARD
+            if (!next_is_param)
+                return false;
+            crawl_state.fsim_spec = next_arg;
+            // A throwaway character, with nothing forked but the workers.
+            if (!rc_only)
+            {
+                Options.no_save = true;
+                Options.pregen_levels = false;
+            }
+# ifdef USE_TILE_LOCAL
+            crawl_state.tiles_disabled = true;
+# endif
+            nextUsed = true;
+#else
+            fprintf(stderr, "-fsim is available only in WIZARD builds.\n");
+            end(1);
+#endif
+            break;
+
+        case CLO_FSIM_JOBS:
+            if (!next_is_param || !isadigit(*next_arg))
+            {
+                fprintf(stderr, "Integer argument required for -%s\n", arg);
+                end(1);
+            }
+            crawl_state.fsim_jobs = atoi(next_arg);
+            nextUsed = true;
+            break;
+
+        case CLO_PROFILE:
+#ifdef PROFILE_ZONES
+            if (!next_is_param)
+                return false;
+            SysEnv.profile_file = next_arg;
+            nextUsed = true;
+#else
+            fprintf(stderr, "-profile is available only in PROFILE_ZONES "
+                    "builds.\n");
+            end(1);
+#endif
+            break;
+
+        case CLO_MEMSTATS:
+            if (!next_is_param)
+                return false;
+            SysEnv.memstats_file = next_arg;
+            nextUsed = true;
+            break;
+
+        case CLO_RECORD:
+            if (!next_is_param || arg_seen[CLO_REPLAY])
+                return false;
+            keylog_record(next_arg);
+            nextUsed = true;
+            break;
+
+        case CLO_REPLAY:
+        {
+            if (!next_is_param || arg_seen[CLO_RECORD])
+                return false;
+            // Before the init file is read, since it brings its own.
+            string err;
+            if (rc_only && !keylog_load(next_arg, err))
+            {
+                fprintf(stderr, "%s\n", err.c_str());
+                end(1);
+            }
+#ifdef USE_TILE_LOCAL
+            crawl_state.tiles_disabled = true;
+#endif
+            nextUsed = true;
+            break;
+        }
+
         case CLO_BUILDDB:
             if (next_is_param)
                 return false;
@@ -4467,6 +4586,14 @@ bool parse_args(int argc, char **argv, bool rc_only)
             nextUsed = true;
             break;
 
+        case CLO_SCORE_QUERY:
+            if (!next_is_param)
+                return false;
+            if (!rc_only)
+                SysEnv.score_query = next_arg;
+            nextUsed = true;
+            break;
+
         case CLO_NAME:
             if (!next_is_param)
                 return false;
@@ -55,11 +55,15 @@ public:
 #endif
 
     string scorefile;
+    string score_query;            // Filter for score listings.
     vector<string> cmd_args;
 
     int map_gen_iters;
     unique_ptr<depth_ranges> map_gen_range;
 
+    string profile_file;           // Where to write zone timings on exit.
+    string memstats_file;          // Where to write memory usage on exit.
+
     vector<string> extra_opts_first;
     vector<string> extra_opts_last;
 
@@ -54,6 +54,7 @@
 #include "spl-summoning.h"
 #include "state.h"
 #include "stringutil.h"
+#include "tags.h"
 #include "throw.h"
 #include "transform.h"
 #include "unicode.h"
@@ -133,6 +134,143 @@ static string _item_inscription(const item_def &item)
                                              ", ").c_str());
 }
 
+/*
+ * name_aux() is where the work of naming an item goes (brands, egos,
+ * artefact names and so on), and it gets asked for the same few names over
+ * and over as menus, the inventory, the stash tracker and autopickup look
+ * at items. So its results are memoised, per item and set of arguments.
+ *
+ * A cached name is used only if it was made in the current identification
+ * generation, which is bumped whenever item types are identified or
+ * forgotten, and if the item's own fields are what they were then; the
+ * latter catches both changes to the item and another item now living at
+ * the same address. Props are compared in their marshalled form, since
+ * artefact properties and their being known, corpse and artefact names
+ * and more all live there. Jewellery reads as "uncursed" only while it
+ * isn't worn, so its equip slot is compared too. Things whose names depend
+ * on more than that (evokers, with their charges, and cropped terse
+ * artefact weapons) aren't cached.
+ */
+#define ITEM_NAME_CACHE_SIZE 4096
+
+struct item_name_key
+{
+    const item_def *item;
+    uint32_t args;
+    iflags_t ignore_flags;
+
+    bool operator < (const item_name_key &other) const
+    {
+        return item != other.item ? item < other.item
+             : args != other.args ? args < other.args
+             : ignore_flags < other.ignore_flags;
+    }
+};
+
+struct item_name_entry
+{
+    unsigned int generation;
+    item_def snapshot; // without props
+    vector<unsigned char> props;
+    int equip_slot;
+    string name;
+};
+
+static map<item_name_key, item_name_entry> item_names;
+static unsigned int item_name_generation = 0;
+
+void invalidate_item_names()
+{
+    ++item_name_generation;
+}
+
+static bool _item_fields_match(const item_def &a, const item_def &b)
+{
+    return a.base_type == b.base_type && a.sub_type == b.sub_type
+           && a.plus == b.plus && a.plus2 == b.plus2
+           && a.special == b.special && a.rnd == b.rnd
+           && a.quantity == b.quantity && a.flags == b.flags
+           && a.pos == b.pos && a.link == b.link
+           && a.inscription == b.inscription;
+}
+
+static vector<unsigned char> _marshalled_props(const item_def &item)
+{
+    vector<unsigned char> buf;
+    if (!item.props.empty())
+    {
+        writer outf(&buf);
+        item.props.write(outf);
+    }
+    return buf;
+}
+
+// Where the item is worn, if that can change its name.
+static int _name_equip_slot(const item_def &item)
+{
+    return item.base_type == OBJ_JEWELLERY ? get_equip_slot(&item) : -1;
+}
+
+static bool _name_cacheable(const item_def &item, bool terse)
+{
+    return item.base_type != OBJ_MISCELLANY
+           && !(terse && item.base_type == OBJ_WEAPONS && is_artefact(item));
+}
+
+string item_def::cached_name_aux(description_level_type desc, bool terse,
+                                 bool ident, bool with_inscription,
+                                 iflags_t ignore_flags) const
+{
+    if (!_name_cacheable(*this, terse))
+        return name_aux(desc, terse, ident, with_inscription, ignore_flags);
+
+    const item_name_key key =
+    {
+        this,
+        static_cast<uint32_t>(desc) << 3 | terse << 2 | ident << 1
+            | with_inscription,
+        ignore_flags
+    };
+
+    vector<unsigned char> marshalled = _marshalled_props(*this);
+    const int equip_slot = _name_equip_slot(*this);
+    auto found = item_names.find(key);
+    if (found != item_names.end()
+        && found->second.generation == item_name_generation
+        && found->second.equip_slot == equip_slot
+        && _item_fields_match(found->second.snapshot, *this)
+        && found->second.props == marshalled)
+    {
+        return found->second.name;
+    }
+
+    const string aux = name_aux(desc, terse, ident, with_inscription,
+                                ignore_flags);
+
+    if (item_names.size() >= ITEM_NAME_CACHE_SIZE)
+        item_names.clear();
+
+    item_name_entry &entry = item_names[key];
+    entry.generation = item_name_generation;
+    entry.props = move(marshalled);
+    entry.equip_slot = equip_slot;
+    entry.name = aux;
+
+    item_def &snap = entry.snapshot;
+    snap.base_type   = base_type;
+    snap.sub_type    = sub_type;
+    snap.plus        = plus;
+    snap.plus2       = plus2;
+    snap.special     = special;
+    snap.rnd         = rnd;
+    snap.quantity    = quantity;
+    snap.flags       = flags;
+    snap.pos         = pos;
+    snap.link        = link;
+    snap.inscription = inscription;
+    return aux;
+}
+
 string item_def::name(description_level_type descrip, bool terse, bool ident,
                       bool with_inscription, bool quantity_in_words,
                       iflags_t ignore_flags) const
@@ -148,8 +286,8 @@ string item_def::name(description_level_type descrip, bool terse, bool ident,
 
     ostringstream buff;
 
-    const string auxname = name_aux(descrip, terse, ident, with_inscription,
-                                    ignore_flags);
+    const string auxname = cached_name_aux(descrip, terse, ident,
+                                           with_inscription, ignore_flags);
 
     const bool startvowel     = is_vowel(auxname[0]);
 
@@ -2244,6 +2382,7 @@ bool set_ident_type(object_class_type basetype, int subtype, bool identify)
         return false;
 
     you.type_ids[basetype][subtype] = identify;
+    invalidate_item_names();
     request_autoinscribe();
 
     // Our item knowledge changed in a way that could possibly affect shop
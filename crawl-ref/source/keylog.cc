@@ -0,0 +1,456 @@
+/**
+ * @file
+ * @brief Recording a game's keystrokes (-record) and replaying them
+ *        without a display (-replay).
+ *
+ * A recording starts with what the game needs to come out the same: the
+ * version, the RNG seed (one is picked if the game wasn't seeded), the
+ * command line and the text of the init file. After that come the raw
+ * keys as the platform layer handed them out, with the time each arrived,
+ * and every kbhit() that found a key waiting, as the number of polls
+ * since the last event (travel and resting stop on those, so they matter
+ * as much as keys do). Every KEYLOG_HASH_INTERVAL keys a hash of the game
+ * state is written too.
+ *
+ * Replaying feeds the same keys and polls back through the same calls, as
+ * fast as the game will take them, with delays and map drawing turned
+ * off. The state hashes are checked on the way, and when the keys run out
+ * a report of the wall time, the per-key latencies and any divergences is
+ * written next to the log.
+ *
+ * The macro file and mouse positions aren't recorded, so replays assume the
+ * same keymaps, and no mouse.
+ *
+ * Since recording always seeds the game, a recorded game loads no ghosts
+ * (see _make_level()): which bones files are lying around isn't part of
+ * the log, so a replay couldn't load the same ones. Ghosts are still saved
+ * when the character dies.
+**/
+
+#include "AppHdr.h"
+
+#include "keylog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+
+#include "act-iter.h"
+#include "end.h"
+#include "initfile.h"
+#include "monster.h"
+#include "options.h"
+#include "player.h"
+#include "state.h"
+#include "stringutil.h"
+#include "syscalls.h"
+#include "version.h"
+
+#define KEYLOG_HASH_INTERVAL 100
+
+enum keylog_mode
+{
+    KEYLOG_OFF,
+    KEYLOG_RECORD,
+    KEYLOG_REPLAY,
+};
+
+struct keylog_event
+{
+    char type;      // 'k'ey, kbhit 'h'it, or 's'tate hash
+    int value;      // the key; polls since the last event; or the key index
+    uint64_t extra; // milliseconds into the game for keys, or the hash
+};
+
+static keylog_mode mode = KEYLOG_OFF;
+static bool started = false;
+static string log_file;
+static FILE *log_out = nullptr;
+
+static vector<keylog_event> events;
+static size_t next_event = 0;
+static uint32_t log_seed = 0;
+
+static int keys_read = 0;
+static int polls = 0;
+
+static chrono::steady_clock::time_point epoch, last_key;
+static vector<double> latencies; // milliseconds spent on each key
+static int state_checks = 0;
+static int divergences = 0;
+static int first_divergence = -1;
+
+static uint64_t _elapsed_ms()
+{
+    return chrono::duration_cast<chrono::milliseconds>(
+               chrono::steady_clock::now() - epoch).count();
+}
+
+// FNV-1a over the things a diverging replay would soon get wrong.
+static uint64_t _state_hash()
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](int64_t value)
+    {
+        for (int i = 0; i < 8; ++i, value >>= 8)
+        {
+            hash ^= value & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(you.num_turns);
+    mix(you.elapsed_time);
+    mix(you.where_are_you);
+    mix(you.depth);
+    mix(you.pos().x);
+    mix(you.pos().y);
+    mix(you.hp);
+    mix(you.magic_points);
+    mix(you.experience);
+    mix(you.gold);
+    for (monster_iterator mi; mi; ++mi)
+    {
+        mix(mi->type);
+        mix(mi->pos().x);
+        mix(mi->pos().y);
+        mix(mi->hit_points);
+    }
+    return hash;
+}
+
+// The command line without the executable and the given option's pair.
+static vector<string> _args_without(const vector<string> &args,
+                                    const string &option)
+{
+    vector<string> result;
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        if (args[i] == "-" + option || args[i] == "--" + option)
+            ++i;
+        else
+            result.push_back(args[i]);
+    }
+    return result;
+}
+
+static bool _parse_event(const string &text, keylog_event &ev)
+{
+    if (text.length() < 3 || text[1] != ' ')
+        return false;
+
+    ev.type = text[0];
+    ev.value = 0;
+    ev.extra = 0;
+    const char *rest = text.c_str() + 2;
+    switch (ev.type)
+    {
+    case 'k':
+        return sscanf(rest, "%" SCNu64 " %d", &ev.extra, &ev.value) == 2;
+    case 'h':
+        return sscanf(rest, "%d", &ev.value) == 1;
+    case 's':
+        return sscanf(rest, "%d %" SCNx64, &ev.value, &ev.extra) == 2;
+    default:
+        return false;
+    }
+}
+
+bool keylog_record(const string &file)
+{
+    mode = KEYLOG_RECORD;
+    log_file = file;
+    return true;
+}
+
+/**
+ * Read a recording made with -record, and point the init file at a copy
+ * of the one it was made with.
+ *
+ * @return whether the log could be read.
+ */
+bool keylog_load(const string &file, string &err)
+{
+    FILE *f = fopen_u(file.c_str(), "r");
+    if (!f)
+    {
+        err = make_stringf("Couldn't open %s", file.c_str());
+        return false;
+    }
+
+    string version, rc;
+    vector<string> args;
+    bool have_seed = false;
+    char line[4096];
+    while (fgets(line, sizeof(line), f))
+    {
+        string text = line;
+        if (!text.empty() && text.back() == '\n')
+            text.pop_back();
+
+        keylog_event ev;
+        if (starts_with(text, "version "))
+            version = text.substr(8);
+        else if (starts_with(text, "seed "))
+            have_seed = sscanf(text.c_str() + 5, "%" SCNx32, &log_seed) == 1;
+        else if (starts_with(text, "arg "))
+            args.push_back(text.substr(4));
+        else if (text == "rc" || starts_with(text, "rc "))
+            rc += (text.length() > 3 ? text.substr(3) : "") + "\n";
+        else if (_parse_event(text, ev))
+            events.push_back(ev);
+        else if (!text.empty() && text[0] != '#')
+        {
+            err = make_stringf("Bad line in %s: %s", file.c_str(),
+                               text.c_str());
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+
+    if (!have_seed)
+    {
+        err = make_stringf("%s has no seed; is it a -record log?",
+                           file.c_str());
+        return false;
+    }
+
+    const string rc_file = file + ".rc";
+    FILE *rcf = fopen_u(rc_file.c_str(), "w");
+    if (!rcf)
+    {
+        err = make_stringf("Couldn't write %s", rc_file.c_str());
+        return false;
+    }
+    fputs(rc.c_str(), rcf);
+    fclose(rcf);
+    SysEnv.crawl_rc = rc_file;
+
+    if (version != Version::Long)
+    {
+        fprintf(stderr, "Warning: %s was recorded with version %s.\n",
+                file.c_str(), version.c_str());
+    }
+    if (args != _args_without(crawl_state.command_line_arguments, "replay"))
+    {
+        const string recorded = comma_separated_line(args.begin(),
+                                                     args.end(), " ", " ");
+        fprintf(stderr, "Warning: %s was recorded with the arguments \"%s\"; "
+                "replays go astray without the same ones.\n",
+                file.c_str(), recorded.c_str());
+    }
+
+    mode = KEYLOG_REPLAY;
+    log_file = file;
+    return true;
+}
+
+/**
+ * Start recording or replaying, just before the RNG is seeded for the
+ * game. Both set Options.seed, which also keeps ghosts out of the game.
+ */
+void keylog_start()
+{
+    if (mode == KEYLOG_OFF || started)
+        return;
+
+    if (mode == KEYLOG_REPLAY)
+    {
+        Options.seed = log_seed;
+        crawl_state.disables.set(DIS_DELAY);
+    }
+    else
+    {
+        while (!Options.seed)
+        {
+            if (!read_urandom((char *) &Options.seed, sizeof(Options.seed)))
+                Options.seed = time(nullptr);
+        }
+
+        log_out = fopen_u(log_file.c_str(), "w");
+        if (!log_out)
+            end(1, true, "Couldn't open %s for writing", log_file.c_str());
+
+        fprintf(log_out, "# %s keystroke log\n", CRAWL);
+        fprintf(log_out, "version %s\n", Version::Long);
+        fprintf(log_out, "seed %" PRIx32 "\n", Options.seed);
+        for (const string &arg
+             : _args_without(crawl_state.command_line_arguments, "record"))
+        {
+            fprintf(log_out, "arg %s\n", arg.c_str());
+        }
+        if (FILE *rc = fopen_u(Options.filename.c_str(), "r"))
+        {
+            char line[4096];
+            while (fgets(line, sizeof(line), rc))
+            {
+                fprintf(log_out, "rc %s%s", line,
+                        ends_with(line, "\n") ? "" : "\n");
+            }
+            fclose(rc);
+        }
+        fflush(log_out);
+    }
+
+    started = true;
+    epoch = last_key = chrono::steady_clock::now();
+}
+
+bool keylog_replaying()
+{
+    return mode == KEYLOG_REPLAY && started;
+}
+
+static void _diverged()
+{
+    if (!divergences++)
+        first_divergence = keys_read;
+}
+
+static int _replay_key()
+{
+    for (; next_event < events.size(); ++next_event)
+    {
+        const keylog_event &ev = events[next_event];
+        if (ev.type == 'k')
+            break;
+
+        // A state we should have reached, or a waiting key that no poll
+        // found this time.
+        if (ev.type == 's')
+        {
+            state_checks++;
+            if (ev.value != keys_read || ev.extra != _state_hash())
+                _diverged();
+        }
+        else
+            _diverged();
+    }
+
+    if (next_event == events.size())
+        end(divergences ? 1 : 0);
+
+    const auto now = chrono::steady_clock::now();
+    if (keys_read)
+    {
+        latencies.push_back(
+            chrono::duration<double, milli>(now - last_key).count());
+    }
+
+    keys_read++;
+    polls = 0;
+    last_key = now;
+    return events[next_event++].value;
+}
+
+/**
+ * Read a key from the given source, recording it, or the next key from
+ * the log instead when replaying.
+ */
+int keylog_getch(int (*source)())
+{
+    if (!started)
+        return source();
+
+    if (mode == KEYLOG_REPLAY)
+        return _replay_key();
+
+    if (keys_read % KEYLOG_HASH_INTERVAL == 0)
+        fprintf(log_out, "s %d %" PRIx64 "\n", keys_read, _state_hash());
+
+    const int key = source();
+    fprintf(log_out, "k %" PRIu64 " %d\n", _elapsed_ms(), key);
+    fflush(log_out);
+    keys_read++;
+    polls = 0;
+    return key;
+}
+
+bool keylog_kbhit(bool (*source)())
+{
+    if (!started)
+        return source();
+
+    ++polls;
+    if (mode == KEYLOG_REPLAY)
+    {
+        if (next_event < events.size() && events[next_event].type == 'h'
+            && events[next_event].value == polls)
+        {
+            ++next_event;
+            polls = 0;
+            return true;
+        }
+        return false;
+    }
+
+    const bool hit = source();
+    if (hit)
+    {
+        fprintf(log_out, "h %d\n", polls);
+        polls = 0;
+    }
+    return hit;
+}
+
+static double _percentile(const vector<double> &sorted, double pct)
+{
+    if (sorted.empty())
+        return 0;
+    const size_t i = min(sorted.size() - 1,
+                         (size_t) (pct / 100 * sorted.size()));
+    return sorted[i];
+}
+
+static void _write_report()
+{
+    const double wall = chrono::duration<double>(
+                            chrono::steady_clock::now() - epoch).count();
+    uint64_t recorded_ms = 0;
+    for (const keylog_event &ev : events)
+        if (ev.type == 'k')
+            recorded_ms = ev.extra;
+
+    vector<double> sorted = latencies;
+    sort(sorted.begin(), sorted.end());
+
+    const string report_file = log_file + ".report.json";
+    FILE *f = fopen_u(report_file.c_str(), "w");
+    if (!f)
+    {
+        fprintf(stderr, "Couldn't write %s\n", report_file.c_str());
+        return;
+    }
+    fprintf(f, "{\n  \"keys\": %d,\n  \"wall_seconds\": %.3f,\n"
+               "  \"recorded_seconds\": %.3f,\n"
+               "  \"latency_ms\": {\"p50\": %.3f, \"p90\": %.3f, "
+               "\"p99\": %.3f, \"max\": %.3f},\n"
+               "  \"state_checks\": %d,\n  \"divergences\": %d,\n"
+               "  \"first_divergence\": %d\n}\n",
+            keys_read, wall, recorded_ms / 1000.0,
+            _percentile(sorted, 50), _percentile(sorted, 90),
+            _percentile(sorted, 99), sorted.empty() ? 0 : sorted.back(),
+            state_checks, divergences, first_divergence);
+    fclose(f);
+
+    printf("Replayed %d keys in %.3fs with %d divergences; report in %s\n",
+           keys_read, wall, divergences, report_file.c_str());
+}
+
+void keylog_finish()
+{
+    if (!started)
+        return;
+    started = false;
+
+    if (mode == KEYLOG_REPLAY)
+        _write_report();
+    else if (log_out)
+    {
+        fclose(log_out);
+        log_out = nullptr;
+    }
+}
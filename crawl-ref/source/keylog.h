@@ -0,0 +1,19 @@
+/**
+ * @file
+ * @brief Recording a game's keystrokes (-record) and replaying them
+ *        without a display (-replay).
+**/
+
+#pragma once
+
+bool keylog_record(const string &file);
+bool keylog_load(const string &file, string &err);
+void keylog_start();
+
+bool keylog_replaying();
+
+int keylog_getch(int (*source)());
+bool keylog_kbhit(bool (*source)());
+
+// Close the log, or write the replay report; on the way out of the game.
+void keylog_finish();
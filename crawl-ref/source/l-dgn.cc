@@ -1909,6 +1909,7 @@ void dluaopen_dgn(lua_State *ls)
     luaL_openlib(ls, "dgn", dgn_build_dlib, 0);
     luaL_openlib(ls, "dgn", dgn_event_dlib, 0);
     luaL_openlib(ls, "dgn", dgn_grid_dlib, 0);
+    luaL_openlib(ls, "dgn", dgn_hyper_dlib, 0);
     luaL_openlib(ls, "dgn", dgn_item_dlib, 0);
     luaL_openlib(ls, "dgn", dgn_level_dlib, 0);
     luaL_openlib(ls, "dgn", dgn_mons_dlib, 0);
@@ -7,6 +7,7 @@
 
 #include "l-libs.h"
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -18,6 +19,7 @@
 #include "dgn-shoals.h"
 #include "dgn-swamp.h"
 #include "dungeon.h"
+#include "stringutil.h"
 
 static const char *exit_glyphs = "{}()[]<>@";
 
@@ -182,6 +184,55 @@ static int _count_passable_neighbors(lua_State *ls, map_lines &lines, int x,
     return count;
 }
 
+// A rectangle of map_lines copied into one contiguous buffer, for passes
+// that visit every cell (often several times) and would otherwise go
+// through the rows of map_lines for each of those visits.
+class glyph_area
+{
+public:
+    glyph_area(const map_lines &lines, int _x1, int _y1, int x2, int y2)
+        : x1(_x1), y1(_y1), width(x2 - _x1 + 1), height(y2 - _y1 + 1),
+          cells(width * height)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            const string &row = lines.get_lines()[y1 + y];
+            copy_n(row.begin() + x1, width, cells.begin() + y * width);
+        }
+    }
+
+    // Write the (possibly changed) glyphs back.
+    void store(map_lines &lines) const
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            copy_n(cells.begin() + y * width, width,
+                   lines.get_lines()[y1 + y].begin() + x1);
+        }
+    }
+
+    bool contains(int x, int y) const
+    {
+        return x >= x1 && x < x1 + width && y >= y1 && y < y1 + height;
+    }
+
+    // Absolute coordinates, as for map_lines.
+    char &operator () (int x, int y)
+    {
+        return cells[(y - y1) * width + x - x1];
+    }
+
+    int index(int x, int y) const
+    {
+        return (y - y1) * width + x - x1;
+    }
+
+    const int x1, y1, width, height;
+
+private:
+    vector<char> cells;
+};
+
 static vector<coord_def> _get_pool_seed_positions(
                                                 vector<vector<int> > pool_index,
                                                 int pool_size,
@@ -571,6 +622,68 @@ LUAFN(dgn_count_passable_neighbors)
     return 1;
 }
 
+/*
+ * neighbor_counts{find, x1, y1, x2, y2}: for every cell of the area, how
+ * many of its eight neighbours are one of the find glyphs, as a table
+ * indexed [x][y] like mapgrd. Neighbours off the map don't count.
+ */
+LUAFN(dgn_neighbor_counts)
+{
+    LINES(ls, 1, lines);
+
+    int x1, y1, x2, y2;
+    if (!_coords(ls, lines, x1, y1, x2, y2))
+        return 0;
+    if (!_valid_coord(ls, lines, x1, y1) || !_valid_coord(ls, lines, x2, y2))
+        return 0;
+
+    TABLE_STR(ls, find, "x");
+
+    // Take the neighbours of the edge cells too.
+    const int ax1 = max(0, x1 - 1), ay1 = max(0, y1 - 1);
+    const int ax2 = min(lines.width() - 1, x2 + 1);
+    const int ay2 = min(lines.height() - 1, y2 + 1);
+    glyph_area area(lines, ax1, ay1, ax2, ay2);
+
+    // 1 for every matching cell, then sum each row's runs of three, then
+    // each column's, leaving the 3x3 sums.
+    vector<int> match(area.width * area.height);
+    for (int y = ay1; y <= ay2; ++y)
+        for (int x = ax1; x <= ax2; ++x)
+            match[area.index(x, y)] = strchr(find, area(x, y)) ? 1 : 0;
+
+    vector<int> rowsum(match.size());
+    for (int y = ay1; y <= ay2; ++y)
+        for (int x = ax1; x <= ax2; ++x)
+        {
+            int sum = match[area.index(x, y)];
+            if (x > ax1)
+                sum += match[area.index(x - 1, y)];
+            if (x < ax2)
+                sum += match[area.index(x + 1, y)];
+            rowsum[area.index(x, y)] = sum;
+        }
+
+    lua_createtable(ls, 0, x2 - x1 + 1);
+    for (int x = x1; x <= x2; ++x)
+    {
+        lua_createtable(ls, 0, y2 - y1 + 1);
+        for (int y = y1; y <= y2; ++y)
+        {
+            int sum = rowsum[area.index(x, y)] - match[area.index(x, y)];
+            if (y > ay1)
+                sum += rowsum[area.index(x, y - 1)];
+            if (y < ay2)
+                sum += rowsum[area.index(x, y + 1)];
+            lua_pushnumber(ls, sum);
+            lua_rawseti(ls, -2, y);
+        }
+        lua_rawseti(ls, -2, x);
+    }
+
+    return 1;
+}
+
 LUAFN(dgn_is_valid_coord)
 {
     LINES(ls, 1, lines);
@@ -607,6 +720,118 @@ LUAFN(dgn_extend_map)
     return 0;
 }
 
+/*
+ * get_area{x1, y1, x2, y2, arrays}: read a rectangle of the map in one go,
+ * as a list of row strings or, with arrays = true, a list of rows that are
+ * lists of one-character strings. Both are indexed from 1.
+ */
+LUAFN(dgn_get_area)
+{
+    LINES(ls, 1, lines);
+
+    int x1, y1, x2, y2;
+    if (!_coords(ls, lines, x1, y1, x2, y2))
+        return 0;
+    if (!_valid_coord(ls, lines, x1, y1) || !_valid_coord(ls, lines, x2, y2))
+        return 0;
+
+    TABLE_BOOL(ls, arrays, false);
+
+    lua_createtable(ls, y2 - y1 + 1, 0);
+    for (int y = y1; y <= y2; ++y)
+    {
+        const string &row = lines.get_lines()[y];
+        if (arrays)
+        {
+            lua_createtable(ls, x2 - x1 + 1, 0);
+            for (int x = x1; x <= x2; ++x)
+            {
+                lua_pushlstring(ls, &row[x], 1);
+                lua_rawseti(ls, -2, x - x1 + 1);
+            }
+        }
+        else
+            lua_pushlstring(ls, row.data() + x1, x2 - x1 + 1);
+        lua_rawseti(ls, -2, y - y1 + 1);
+    }
+
+    return 1;
+}
+
+/*
+ * set_area{x1, y1, rows, width, transparent}: write a rectangle of the map
+ * in one go, with its top left corner at x1, y1. rows is a string (rows
+ * separated by newlines) or a list of rows, each either a string or a list
+ * of one-character strings. In a list, cells that are nil (up to width,
+ * if given) are left alone, as are cells that are the transparent glyph.
+ */
+LUAFN(dgn_set_area)
+{
+    LINES(ls, 1, lines);
+
+    TABLE_INT(ls, x1, 0);
+    TABLE_INT(ls, y1, 0);
+    TABLE_INT(ls, width, -1);
+    TABLE_CHAR(ls, transparent, '\0');
+
+    if (!_valid_coord(ls, lines, x1, y1))
+        return 0;
+
+    vector<string> rows;
+    lua_getfield(ls, -1, "rows");
+    if (lua_isstring(ls, -1))
+        rows = split_string("\n", lua_tostring(ls, -1), false, true);
+    else if (lua_istable(ls, -1))
+    {
+        for (int i = 1; ; ++i)
+        {
+            lua_rawgeti(ls, -1, i);
+            if (lua_isnil(ls, -1))
+            {
+                lua_pop(ls, 1);
+                break;
+            }
+
+            if (lua_isstring(ls, -1))
+                rows.emplace_back(lua_tostring(ls, -1));
+            else if (lua_istable(ls, -1))
+            {
+                // Holes are left as '\0', which is never a real glyph.
+                const int len = width >= 0 ? width : lua_objlen(ls, -1);
+                string row(len, '\0');
+                for (int x = 0; x < len; ++x)
+                {
+                    lua_rawgeti(ls, -1, x + 1);
+                    const char *glyph = lua_tostring(ls, -1);
+                    if (glyph && glyph[0])
+                        row[x] = glyph[0];
+                    lua_pop(ls, 1);
+                }
+                rows.push_back(row);
+            }
+            else
+                return luaL_error(ls, "Bad row %d in set_area", i);
+            lua_pop(ls, 1);
+        }
+    }
+    else
+        return luaL_error(ls, "set_area needs rows");
+    lua_pop(ls, 1);
+
+    for (int y = 0; y < (int) rows.size(); ++y)
+    {
+        const string &row = rows[y];
+        if (row.empty())
+            continue;
+        _valid_coord(ls, lines, x1 + row.length() - 1, y1 + y);
+        for (int x = 0; x < (int) row.length(); ++x)
+            if (row[x] && row[x] != transparent)
+                lines(x1 + x, y1 + y) = row[x];
+    }
+
+    return 0;
+}
+
 LUAFN(dgn_fill_area)
 {
     LINES(ls, 1, lines);
@@ -666,6 +891,222 @@ LUAFN(dgn_fill_disconnected)
     return 0;
 }
 
+/*
+ * flood_fill{x, y, fill, passable, diagonal}: fill the region connected to
+ * x, y whose cells pass passable, which is either a string of glyphs or a
+ * function(glyph, x, y) returning a boolean. Returns the number of cells
+ * filled (0 if x, y doesn't pass).
+ */
+LUAFN(dgn_flood_fill)
+{
+    LINES(ls, 1, lines);
+
+    TABLE_INT(ls, x, -1);
+    TABLE_INT(ls, y, -1);
+    TABLE_CHAR(ls, fill, 'x');
+    TABLE_BOOL(ls, diagonal, true);
+
+    if (!_valid_coord(ls, lines, x, y))
+        return 0;
+
+    const char *passable = traversable_glyphs;
+    lua_getfield(ls, -1, "passable");
+    const bool predicate = lua_isfunction(ls, -1);
+    if (lua_isstring(ls, -1))
+        passable = lua_tostring(ls, -1);
+    const int pred = lua_gettop(ls);
+
+    glyph_area area(lines, 0, 0, lines.width() - 1, lines.height() - 1);
+
+    auto passes = [&](int px, int py)
+    {
+        const char glyph = area(px, py);
+        if (!predicate)
+            return strchr(passable, glyph) != nullptr;
+
+        lua_pushvalue(ls, pred);
+        lua_pushlstring(ls, &glyph, 1);
+        lua_pushnumber(ls, px);
+        lua_pushnumber(ls, py);
+        lua_call(ls, 3, 1);
+        const bool ok = lua_toboolean(ls, -1);
+        lua_pop(ls, 1);
+        return ok;
+    };
+
+    // 0: not looked at yet, 1: queued, 2: doesn't pass.
+    vector<char> seen(area.width * area.height, 0);
+    vector<coord_def> queue;
+    if (passes(x, y))
+    {
+        queue.emplace_back(x, y);
+        seen[area.index(x, y)] = 1;
+    }
+
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        const coord_def c = queue[i];
+        for (int dy = -1; dy <= 1; ++dy)
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                if ((!dx && !dy) || (!diagonal && dx && dy))
+                    continue;
+
+                const int nx = c.x + dx, ny = c.y + dy;
+                if (!area.contains(nx, ny) || seen[area.index(nx, ny)])
+                    continue;
+
+                const bool ok = passes(nx, ny);
+                seen[area.index(nx, ny)] = ok ? 1 : 2;
+                if (ok)
+                    queue.emplace_back(nx, ny);
+            }
+    }
+
+    // Only fill once the whole region is known, so that the predicate
+    // sees the map as it was.
+    for (const coord_def &c : queue)
+        area(c.x, c.y) = fill;
+    area.store(lines);
+
+    lua_pushnumber(ls, queue.size());
+    return 1;
+}
+
+/*
+ * fill_small_zones{keep, fill, wall, min_size}: fill every region of floor
+ * (anything not in wall) except the keep largest with more than min_size
+ * cells. This is zonify.map_fill_zones, which needed several Lua calls for
+ * every cell of the map. Zones are discovered in the order zonify.walk
+ * found them, so that ties between equally large zones go the same way.
+ */
+LUAFN(dgn_fill_small_zones)
+{
+    LINES(ls, 1, lines);
+
+    TABLE_INT(ls, keep, 1);
+    TABLE_CHAR(ls, fill, 'x');
+    TABLE_STR(ls, wall, "wlxcvbtg");
+    TABLE_INT(ls, min_size, 1);
+
+    if (lines.width() < X_BOUND_2 || lines.height() < Y_BOUND_2)
+        return luaL_error(ls, "fill_small_zones needs the whole map");
+    if (keep <= 0)
+        return 0;
+
+    glyph_area area(lines, 0, 0, X_BOUND_2 - 1, Y_BOUND_2 - 1);
+
+    struct zone
+    {
+        bool is_wall;
+        int size;
+        vector<coord_def> borders;
+    };
+    vector<zone> zones;
+    // Zone number + 1 for each cell, 0 if it hasn't been walked yet.
+    vector<int> zone_of(area.width * area.height, 0);
+
+    // zonify.walk, with its recursion unrolled: every frame first walks
+    // its neighbours, then (if it started a zone) that zone's borders.
+    struct walk_frame
+    {
+        coord_def pos;
+        int zone;
+        bool new_zone;
+        bool in_borders;
+        size_t next;
+    };
+    vector<walk_frame> stack;
+    static const coord_def dirs[] =
+    {
+        { 0, -1 }, { -1, 0 }, { 0, 1 }, { 1, 0 },
+        { -1, -1 }, { -1, 1 }, { 1, 1 }, { 1, -1 },
+    };
+
+    auto walk = [&](const coord_def &c, int z)
+    {
+        if (!in_bounds(c) || zone_of[area.index(c.x, c.y)])
+            return;
+
+        const bool is_wall = strchr(wall, area(c.x, c.y));
+        const bool new_zone = z < 0;
+        if (new_zone)
+        {
+            zones.push_back({ is_wall, 0, {} });
+            z = zones.size() - 1;
+        }
+
+        if (is_wall == zones[z].is_wall)
+        {
+            zones[z].size++;
+            zone_of[area.index(c.x, c.y)] = z + 1;
+            stack.push_back({ c, z, new_zone, false, 0 });
+        }
+        else
+            zones[z].borders.push_back(c);
+    };
+
+    walk(coord_def(X_BOUND_1 + 1, Y_BOUND_1 + 1), -1);
+    while (!stack.empty())
+    {
+        walk_frame &frame = stack.back();
+        if (!frame.in_borders)
+        {
+            if (frame.next < ARRAYSZ(dirs))
+            {
+                const coord_def next = frame.pos + dirs[frame.next++];
+                walk(next, frame.zone);
+                continue;
+            }
+            if (!frame.new_zone)
+            {
+                stack.pop_back();
+                continue;
+            }
+            frame.in_borders = true;
+            frame.next = 0;
+        }
+
+        if (frame.next < zones[frame.zone].borders.size())
+        {
+            const coord_def next = zones[frame.zone].borders[frame.next++];
+            walk(next, -1);
+        }
+        else
+            stack.pop_back();
+    }
+
+    // The largest floor zones, largest first, earliest found on ties.
+    vector<int> largest;
+    for (int z = 0; z < (int) zones.size(); ++z)
+    {
+        if (zones[z].is_wall || zones[z].size <= min_size)
+            continue;
+
+        auto pos = largest.begin();
+        while (pos != largest.end() && zones[*pos].size >= zones[z].size)
+            ++pos;
+        if (pos - largest.begin() < keep)
+            largest.insert(pos, z);
+        if ((int) largest.size() > keep)
+            largest.pop_back();
+    }
+
+    for (int y = 0; y < area.height; ++y)
+        for (int x = 0; x < area.width; ++x)
+        {
+            const int z = zone_of[area.index(x, y)] - 1;
+            if (z >= 0 && !zones[z].is_wall
+                && find(largest.begin(), largest.end(), z) == largest.end())
+            {
+                area(x, y) = fill;
+            }
+        }
+    area.store(lines);
+
+    return 0;
+}
+
 LUAFN(dgn_is_passable_coord)
 {
     LINES(ls, 1, lines);
@@ -1738,21 +2179,55 @@ LUAFN(dgn_add_windows)
     return 0;
 }
 
+// With a mask (rows lined up with x1, y1, as a string or a list of
+// strings, like the ones get_area returns), only cells whose mask glyph
+// is in mask_glyphs, or isn't a space if that isn't given, are replaced.
 LUAFN(dgn_replace_area)
 {
     LINES(ls, 1, lines);
 
     TABLE_STR(ls, find, 0);
     TABLE_CHAR(ls, replace, '\0');
+    TABLE_STR(ls, mask_glyphs, nullptr);
 
     int x1, y1, x2, y2;
     if (!_coords(ls, lines, x1, y1, x2, y2))
         return 0;
 
+    vector<string> mask;
+    lua_getfield(ls, -1, "mask");
+    if (lua_isstring(ls, -1))
+        mask = split_string("\n", lua_tostring(ls, -1), false, true);
+    else if (lua_istable(ls, -1))
+    {
+        for (int i = 1; ; ++i)
+        {
+            lua_rawgeti(ls, -1, i);
+            const char *row = lua_tostring(ls, -1);
+            lua_pop(ls, 1);
+            if (!row)
+                break;
+            mask.emplace_back(row);
+        }
+    }
+    const bool masked = !lua_isnil(ls, -1);
+    lua_pop(ls, 1);
+
     for (int y = y1; y <= y2; ++y)
         for (int x = x1; x <= x2; ++x)
+        {
+            if (masked)
+            {
+                const int my = y - y1, mx = x - x1;
+                if (my >= (int) mask.size() || mx >= (int) mask[my].length())
+                    continue;
+                const char m = mask[my][mx];
+                if (mask_glyphs ? !strchr(mask_glyphs, m) : m == ' ')
+                    continue;
+            }
             if (strchr(find, lines(x, y)))
                 lines(x, y) = replace;
+        }
 
     return 0;
 }
@@ -2290,11 +2765,16 @@ const struct luaL_reg dgn_build_dlib[] =
     { "count_antifeature_in_box", &dgn_count_antifeature_in_box },
     { "count_neighbors", &dgn_count_neighbors },
     { "count_passable_neighbors", &dgn_count_passable_neighbors },
+    { "neighbor_counts", &dgn_neighbor_counts },
     { "is_valid_coord", &dgn_is_valid_coord },
     { "is_passable_coord", &dgn_is_passable_coord },
     { "extend_map", &dgn_extend_map },
+    { "get_area", &dgn_get_area },
+    { "set_area", &dgn_set_area },
     { "fill_area", &dgn_fill_area },
     { "fill_disconnected", &dgn_fill_disconnected },
+    { "fill_small_zones", &dgn_fill_small_zones },
+    { "flood_fill", &dgn_flood_fill },
     { "find_in_area", &dgn_find_in_area },
     { "height", dgn_height },
     { "primary_vault_dimensions", &dgn_primary_vault_dimensions },
@@ -0,0 +1,342 @@
+/**
+ * @file
+ * @brief Native passes for the hyper layout engine (dlua/layout/hyper*.lua).
+ *
+ * These do exactly what the Lua functions they replace did, usage table by
+ * usage table, including the order in which cells go into the eligibles
+ * and anchors lists (which later random picks index into), so layouts come
+ * out the same for the same random draws. They just do it without a Lua
+ * call, or several C calls, per cell of the map.
+**/
+
+#include "AppHdr.h"
+
+#include "l-libs.h"
+
+#include "cluautil.h"
+#include "coord.h"
+#include "dungeon.h"
+#include "env.h"
+#include "terrain.h"
+
+static int _abs_index(lua_State *ls, int idx)
+{
+    return idx < 0 ? lua_gettop(ls) + idx + 1 : idx;
+}
+
+static bool _usage_flag(lua_State *ls, int usage, const char *key)
+{
+    lua_getfield(ls, usage, key);
+    const bool flag = lua_toboolean(ls, -1);
+    lua_pop(ls, 1);
+    return flag;
+}
+
+static void _set_usage_flag(lua_State *ls, int usage, const char *key,
+                            bool flag)
+{
+    usage = _abs_index(ls, usage);
+    lua_pushboolean(ls, flag);
+    lua_setfield(ls, usage, key);
+}
+
+// Push { x = x, y = y }.
+static void _push_point(lua_State *ls, int x, int y)
+{
+    lua_createtable(ls, 0, 2);
+    lua_pushnumber(ls, x);
+    lua_setfield(ls, -2, "x");
+    lua_pushnumber(ls, y);
+    lua_setfield(ls, -2, "y");
+}
+
+// table.insert(t, value) for the value on top of the stack.
+static void _append(lua_State *ls, int t)
+{
+    const int n = lua_objlen(ls, t);
+    lua_rawseti(ls, t, n + 1);
+}
+
+// Push hyper.usage.get_usage(grid, x, y).
+static void _push_usage(lua_State *ls, int grid, int x, int y)
+{
+    lua_pushnumber(ls, y);
+    lua_gettable(ls, grid);
+    if (lua_isnil(ls, -1))
+        return;
+    lua_pushnumber(ls, x);
+    lua_gettable(ls, -2);
+    lua_remove(ls, -2);
+}
+
+// Push vector.<name>, the direction lists set up by hyper.lua.
+static int _push_directions(lua_State *ls, const char *name)
+{
+    lua_getglobal(ls, "vector");
+    luaL_checktype(ls, -1, LUA_TTABLE);
+    lua_getfield(ls, -1, name);
+    lua_remove(ls, -2);
+    luaL_checktype(ls, -1, LUA_TTABLE);
+    return lua_gettop(ls);
+}
+
+/*
+ * dgn.hyper_new_usage(width, height): hyper.usage.new_usage() with
+ * hyper.usage.grid_initialiser, that is, a usage grid describing the
+ * dungeon grid as it stands. Like new_usage(), it also sets the global
+ * usage_grid.
+ */
+LUAFN(dgn_hyper_new_usage)
+{
+    const int width = luaL_checkint(ls, 1);
+    const int height = luaL_checkint(ls, 2);
+
+    lua_createtable(ls, height, 4);
+    const int grid = lua_gettop(ls);
+
+    lua_createtable(ls, 0, 2);
+    lua_newtable(ls);
+    lua_setfield(ls, -2, "open");
+    lua_newtable(ls);
+    lua_setfield(ls, -2, "closed");
+    lua_setfield(ls, grid, "eligibles");
+    lua_newtable(ls);
+    lua_setfield(ls, grid, "anchors");
+    lua_pushnumber(ls, width);
+    lua_setfield(ls, grid, "width");
+    lua_pushnumber(ls, height);
+    lua_setfield(ls, grid, "height");
+
+    for (int y = 0; y < height; ++y)
+    {
+        lua_createtable(ls, width, 1);
+        for (int x = 0; x < width; ++x)
+        {
+            const coord_def c(x, y);
+            if (!map_bounds(c))
+                luaL_error(ls, "Point out of bounds: (%d,%d)", x, y);
+            const dungeon_feature_type feat = grd(c);
+
+            lua_createtable(ls, 0, 7);
+            lua_pushnumber(ls, feat);
+            lua_setfield(ls, -2, "feature");
+            _set_usage_flag(ls, -1, "vault",
+                            env.level_map_mask(c) & MMT_VAULT);
+            lua_newtable(ls);
+            lua_setfield(ls, -2, "anchors");
+            _set_usage_flag(ls, -1, "space", false);
+            _set_usage_flag(ls, -1, "carvable", false);
+            _set_usage_flag(ls, -1, "solid",
+                            !(feat_has_solid_floor(feat)
+                              || feat_is_door(feat)));
+            _set_usage_flag(ls, -1, "wall", feat_is_wall(feat));
+            lua_rawseti(ls, -2, x);
+        }
+        lua_rawseti(ls, grid, y);
+    }
+
+    lua_pushvalue(ls, grid);
+    lua_setglobal(ls, "usage_grid");
+    return 1;
+}
+
+// hyper.usage.set_usage(grid, x, y, usage) where usage is already the
+// usage at x, y.
+static void _reset_usage(lua_State *ls, int grid, int x, int y, int usage)
+{
+    lua_getfield(ls, grid, "eligibles");
+    const int eligibles = lua_gettop(ls);
+
+    lua_getfield(ls, usage, "eligibles_index");
+    if (!lua_isnil(ls, -1))
+    {
+        // Through table.remove itself, to keep its handling of indices
+        // that have gone stale.
+        const int index = lua_gettop(ls);
+        lua_getglobal(ls, "table");
+        lua_getfield(ls, -1, "remove");
+        lua_getfield(ls, usage, "eligibles_which");
+        lua_gettable(ls, eligibles);
+        lua_pushvalue(ls, index);
+        lua_call(ls, 2, 0);
+        lua_pop(ls, 1);
+    }
+    lua_pop(ls, 1);
+
+    if (!_usage_flag(ls, usage, "vault")
+        && (_usage_flag(ls, usage, "carvable")
+            || !_usage_flag(ls, usage, "solid")))
+    {
+        _push_point(ls, x, y);
+        lua_setfield(ls, usage, "spot");
+
+        const char *which = _usage_flag(ls, usage, "solid") ? "closed"
+                                                            : "open";
+        lua_getfield(ls, eligibles, which);
+        const int list = lua_gettop(ls);
+        lua_pushvalue(ls, usage);
+        _append(ls, list);
+        lua_pushstring(ls, which);
+        lua_setfield(ls, usage, "eligibles_which");
+        lua_pushnumber(ls, lua_objlen(ls, list));
+        lua_setfield(ls, usage, "eligibles_index");
+        lua_pop(ls, 1);
+    }
+    lua_pop(ls, 1);
+
+    lua_getfield(ls, usage, "anchors");
+    if (!lua_isnil(ls, -1))
+    {
+        const int anchors = lua_gettop(ls);
+        lua_getfield(ls, grid, "anchors");
+        const int all_anchors = lua_gettop(ls);
+        for (int i = 1; ; ++i)
+        {
+            lua_rawgeti(ls, anchors, i);
+            if (lua_isnil(ls, -1))
+            {
+                lua_pop(ls, 1);
+                break;
+            }
+            _append(ls, all_anchors);
+        }
+        lua_pop(ls, 1);
+    }
+    lua_pop(ls, 1);
+
+    lua_pushnumber(ls, y);
+    lua_gettable(ls, grid);
+    lua_pushvalue(ls, usage);
+    lua_rawseti(ls, -2, x);
+    lua_pop(ls, 1);
+}
+
+/*
+ * dgn.hyper_analyse_usage(usage_grid): hyper.usage.analyse_grid_usage().
+ * Marks walls next to open space as carvable, anchoring to them, and open
+ * space next to anything solid as buffer, then updates the eligibles and
+ * anchors lists.
+ */
+LUAFN(dgn_hyper_analyse_usage)
+{
+    luaL_checktype(ls, 1, LUA_TTABLE);
+    const int grid = 1;
+    lua_settop(ls, 1);
+
+    lua_getfield(ls, grid, "width");
+    const int width = lua_tointeger(ls, -1);
+    lua_getfield(ls, grid, "height");
+    const int height = lua_tointeger(ls, -1);
+    lua_pop(ls, 2);
+
+    const int normals = _push_directions(ls, "normals");
+    const int directions = _push_directions(ls, "directions");
+    const int num_normals = lua_objlen(ls, normals);
+    const int num_directions = lua_objlen(ls, directions);
+
+    for (int x = 0; x < width; ++x)
+        for (int y = 0; y < height; ++y)
+        {
+            _push_usage(ls, grid, x, y);
+            const int usage = lua_gettop(ls);
+            if (!lua_istable(ls, usage))
+                luaL_error(ls, "No usage at (%d,%d)", x, y);
+
+            if (_usage_flag(ls, usage, "vault"))
+            {
+                lua_pop(ls, 1);
+                continue;
+            }
+
+            if (_usage_flag(ls, usage, "wall"))
+            {
+                for (int i = 1; i <= num_normals; ++i)
+                {
+                    lua_rawgeti(ls, normals, i);
+                    const int normal = lua_gettop(ls);
+                    lua_getfield(ls, normal, "x");
+                    lua_getfield(ls, normal, "y");
+                    lua_getfield(ls, normal, "dir");
+                    const int nx = lua_tointeger(ls, -3);
+                    const int ny = lua_tointeger(ls, -2);
+                    const int dir = lua_tointeger(ls, -1);
+                    lua_pop(ls, 3);
+
+                    _push_usage(ls, grid, x + nx, y + ny);
+                    if (!lua_isnil(ls, -1) && !_usage_flag(ls, -1, "solid"))
+                    {
+                        _set_usage_flag(ls, usage, "carvable", true);
+
+                        lua_getfield(ls, usage, "anchors");
+                        const int anchors = lua_gettop(ls);
+                        if (!lua_istable(ls, anchors))
+                            luaL_error(ls, "No anchors at (%d,%d)", x, y);
+                        lua_createtable(ls, 0, 3);
+                        lua_rawgeti(ls, normals, (dir + 2) % 4 + 1);
+                        lua_setfield(ls, -2, "normal");
+                        _push_point(ls, 0, 0);
+                        lua_setfield(ls, -2, "pos");
+                        _push_point(ls, x, y);
+                        lua_setfield(ls, -2, "grid_pos");
+                        _append(ls, anchors);
+                        lua_pop(ls, 1);
+                    }
+                    lua_pop(ls, 2);
+                }
+            }
+            else if (!_usage_flag(ls, usage, "solid"))
+            {
+                for (int i = 1; i <= num_directions; ++i)
+                {
+                    lua_rawgeti(ls, directions, i);
+                    lua_getfield(ls, -1, "x");
+                    lua_getfield(ls, -2, "y");
+                    const int nx = lua_tointeger(ls, -2);
+                    const int ny = lua_tointeger(ls, -1);
+                    lua_pop(ls, 3);
+
+                    _push_usage(ls, grid, x + nx, y + ny);
+                    if (!lua_isnil(ls, -1) && _usage_flag(ls, -1, "solid"))
+                        _set_usage_flag(ls, usage, "buffer", true);
+                    lua_pop(ls, 1);
+                }
+            }
+
+            _reset_usage(ls, grid, x, y, usage);
+            lua_pop(ls, 1);
+        }
+
+    return 0;
+}
+
+/*
+ * dgn.hyper_protect_usage(usage_grid): set MMT_VAULT on every cell of the
+ * map whose usage is marked protect, so that ordinary vaults don't get
+ * placed over the layout's architecture.
+ */
+LUAFN(dgn_hyper_protect_usage)
+{
+    luaL_checktype(ls, 1, LUA_TTABLE);
+    const int grid = 1;
+    lua_settop(ls, 1);
+
+    for (int x = 0; x < GXM; ++x)
+        for (int y = 0; y < GYM; ++y)
+        {
+            _push_usage(ls, grid, x, y);
+            if (!lua_isnil(ls, -1) && _usage_flag(ls, -1, "protect"))
+                env.level_map_mask(coord_def(x, y)) |= MMT_VAULT;
+            lua_pop(ls, 1);
+        }
+
+    return 0;
+}
+
+const struct luaL_reg dgn_hyper_dlib[] =
+{
+{ "hyper_new_usage", dgn_hyper_new_usage },
+{ "hyper_analyse_usage", dgn_hyper_analyse_usage },
+{ "hyper_protect_usage", dgn_hyper_protect_usage },
+
+{ nullptr, nullptr }
+};
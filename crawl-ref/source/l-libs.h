@@ -47,6 +47,7 @@ extern const struct luaL_reg dgn_dlib[];
 extern const struct luaL_reg dgn_build_dlib[];
 extern const struct luaL_reg dgn_event_dlib[];
 extern const struct luaL_reg dgn_grid_dlib[];
+extern const struct luaL_reg dgn_hyper_dlib[];
 extern const struct luaL_reg dgn_item_dlib[];
 extern const struct luaL_reg dgn_level_dlib[];
 extern const struct luaL_reg dgn_mons_dlib[];
@@ -490,6 +490,36 @@ LUAFN(you_train_skill)
     PLUARET(number, you.train[sk]);
 }
 
+/*
+ * you.project_training(xp [, stepwise]): the skill points and levels that
+ * spending xp with the current training would give, as two tables keyed by
+ * skill name. Nothing changes. With stepwise, training goes a step at a
+ * time as it used to, to check the quick way against.
+ */
+LUAFN(you_project_training)
+{
+    const int exp = luaL_checkint(ls, 1);
+    const FixedVector<unsigned int, NUM_SKILLS> points
+        = project_training(exp, lua_toboolean(ls, 2));
+
+    lua_newtable(ls);
+    lua_newtable(ls);
+    for (skill_type sk = SK_FIRST_SKILL; sk < NUM_SKILLS; ++sk)
+    {
+        int level = 0;
+        while (level < MAX_SKILL_LEVEL
+               && points[sk] >= skill_exp_needed(level + 1, sk))
+        {
+            ++level;
+        }
+        lua_pushnumber(ls, points[sk]);
+        lua_setfield(ls, -3, skill_name(sk));
+        lua_pushnumber(ls, level);
+        lua_setfield(ls, -2, skill_name(sk));
+    }
+    return 2;
+}
+
 LUAFN(you_skill_cost)
 {
     skill_type sk = str_to_skill(luaL_checkstring(ls, 1));
@@ -572,6 +602,7 @@ static const struct luaL_reg you_clib[] =
     { "best_skill",   you_best_skill },
     { "train_skill",  you_train_skill },
     { "skill_cost"  , you_skill_cost },
+    { "project_training", you_project_training },
     { "xl"          , you_xl },
     { "xl_progress" , you_xl_progress },
     { "res_poison"  , you_res_poison },
@@ -868,6 +899,7 @@ static const struct luaL_reg you_dlib[] =
 { "exercise",           you_exercise },
 { "skill_cost_level",   you_skill_cost_level },
 { "skill_points",       you_skill_points },
+{ "project_training",   you_project_training },
 { "zigs_completed",     you_zigs_completed },
 
 { nullptr, nullptr }
@@ -14,6 +14,7 @@
 #include "cio.h"
 #include "defines.h"
 #include "env.h"
+#include "keylog.h"
 #include "message.h"
 #include "state.h"
 #include "terrain.h"
@@ -146,11 +147,16 @@ int num_to_lines(int num)
     return tiles.to_lines(num);
 }
 
-int getch_ck()
+static int _getch_ck()
 {
     return tiles.getch_ck();
 }
 
+int getch_ck()
+{
+    return keylog_getch(_getch_ck);
+}
+
 int getchk()
 {
     return getch_ck();
@@ -193,7 +199,7 @@ void update_screen()
     tiles.set_need_redraw();
 }
 
-bool kbhit()
+static bool _kbhit()
 {
     if (crawl_state.tiles_disabled)
         return false;
@@ -203,6 +209,11 @@ bool kbhit()
     return count > 0;
 }
 
+bool kbhit()
+{
+    return keylog_kbhit(_kbhit);
+}
+
 void console_startup()
 {
     tiles.resize();
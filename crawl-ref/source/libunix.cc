@@ -34,6 +34,7 @@
 #include "colour.h"
 #include "cio.h"
 #include "crash.h"
+#include "keylog.h"
 #include "state.h"
 #include "unicode.h"
 #include "view.h"
@@ -468,7 +469,7 @@ static int proc_mouse_event(int c, const MEVENT *me)
 
 static int pending = 0;
 
-int getchk()
+static int _getchk()
 {
 #ifdef WATCHDOG
     // If we have (or wait for) actual keyboard input, it's not an infinite
@@ -510,6 +511,11 @@ int getchk()
     return -c;
 }
 
+int getchk()
+{
+    return keylog_getch(_getchk);
+}
+
 int m_getch()
 {
     int c;
@@ -1557,7 +1563,7 @@ void delay(unsigned int time)
 }
 
 /* This is Juho Snellman's modified kbhit, to work with macros */
-bool kbhit()
+static bool _kbhit()
 {
     if (pending)
         return true;
@@ -1591,3 +1597,8 @@ bool kbhit()
     return result;
 #endif
 }
+
+bool kbhit()
+{
+    return keylog_kbhit(_kbhit);
+}
@@ -61,6 +61,7 @@
 
 #include "cio.h"
 #include "defines.h"
+#include "keylog.h"
 #include "libutil.h"
 #include "options.h"
 #include "state.h"
@@ -769,7 +770,7 @@ static int w32_proc_mouse_event(const MOUSE_EVENT_RECORD &mer)
     return 0;
 }
 
-int getch_ck()
+static int _getch_ck()
 {
     INPUT_RECORD ir;
     DWORD nread;
@@ -839,13 +840,18 @@ int getch_ck()
     return key;
 }
 
+int getch_ck()
+{
+    return keylog_getch(_getch_ck);
+}
+
 int getchk()
 {
     int c = getch_ck();
     return key_to_command(c);
 }
 
-bool kbhit()
+static bool _kbhit()
 {
     if (crawl_state.seen_hups)
         return 1;
@@ -868,6 +874,11 @@ bool kbhit()
     return 0;
 }
 
+bool kbhit()
+{
+    return keylog_kbhit(_kbhit);
+}
+
 void delay(unsigned int ms)
 {
     if (crawl_state.disables[DIS_DELAY])
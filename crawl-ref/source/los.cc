@@ -48,10 +48,12 @@
 #include <cmath>
 
 #include "areas.h"
+#include "bench.h"
 #include "coord.h"
 #include "coordit.h"
 #include "env.h"
 #include "losglobal.h"
+#include "profiler.h"
 
 // These determine what rays are cast in the precomputation,
 // and affect start-up time significantly.
@@ -863,6 +865,8 @@ void losight(los_grid& sh, const coord_def& center,
 {
     const los_param& dat = los_param_funcs(center, opc, bounds);
 
+    PROF_ZONE("losight");
+    ++bench_counts.los_calls;
     sh.init(false);
 
     // Do precomputations if necessary.
@@ -2,10 +2,14 @@
 
 #include "losglobal.h"
 
+#include <cstdlib>
+
+#include "bitary.h"
 #include "coord.h"
 #include "coordit.h"
 #include "libutil.h"
 #include "los-def.h"
+#include "profiler.h"
 
 #define LOS_KNOWN 4
 
@@ -15,9 +19,44 @@ static const int o_half_x = 0;
 static const int o_half_y = LOS_MAX_RANGE;
 typedef halflos_t globallos_t[GXM][GYM];
 
-static globallos_t globallos;
+// The cache is allocated when first written to, with calloc so that pages
+// nothing has written to never become resident, and invalidating it only
+// clears the origins that have been written to since it was last cleared.
+static globallos_t *globallos = nullptr;
+static FixedBitArray<GXM, GYM> globallos_used;
+static int globallos_num_used = 0;
+
+static halflos_t &_globallos_at(int x, int y, bool writing)
+{
+    if (writing)
+    {
+        if (!globallos)
+        {
+            globallos = static_cast<globallos_t *>(
+                calloc(1, sizeof(globallos_t)));
+            if (!globallos)
+                die("Out of memory allocating the LOS cache");
+        }
+        if (!globallos_used(x, y))
+        {
+            globallos_used.set(x, y);
+            globallos_num_used++;
+        }
+    }
+    return (*globallos)[x][y];
+}
+
+static void _clear_globallos_at(int x, int y)
+{
+    if (!globallos_used(x, y))
+        return;
+    memset((*globallos)[x][y], 0, sizeof(halflos_t));
+    globallos_used.set(x, y, false);
+    globallos_num_used--;
+}
 
-static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q)
+static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q,
+                                     bool writing = false)
 {
     COMPILE_CHECK(LOS_KNOWN * 2 <= sizeof(losfield_t) * 8);
 
@@ -26,11 +65,24 @@ static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q)
     coord_def diff = q - p;
     if (diff.rdist() > LOS_RADIUS)
         return nullptr;
+    // Nothing is known yet.
+    if (!writing && !globallos)
+    {
+        static losfield_t unknown;
+        unknown = 0;
+        return &unknown;
+    }
     // p < q iff p.x < q.x || p.x == q.x && p.y < q.y
     if (diff < coord_def(0, 0))
-        return &globallos[q.x][q.y][-diff.x + o_half_x][-diff.y + o_half_y];
+    {
+        return &_globallos_at(q.x, q.y, writing)
+                   [-diff.x + o_half_x][-diff.y + o_half_y];
+    }
     else
-        return &globallos[p.x][p.y][ diff.x + o_half_x][ diff.y + o_half_y];
+    {
+        return &_globallos_at(p.x, p.y, writing)
+                   [ diff.x + o_half_x][ diff.y + o_half_y];
+    }
 }
 
 static void _save_los(los_def* los, los_type l)
@@ -47,7 +99,7 @@ static void _save_los(los_def* los, los_type l)
                 continue;
 
             coord_def ri(x, y);
-            losfield_t* flags = _lookup_globallos(o, ri);
+            losfield_t* flags = _lookup_globallos(o, ri, true);
             if (!flags)
                 continue;
             *flags |= l << LOS_KNOWN;
@@ -65,15 +117,29 @@ void invalidate_los_around(const coord_def& p)
     int y1 = max(p.y - LOS_MAX_RANGE, 0);
     int x2 = min(p.x, GXM - 1);
     int y2 = min(p.y + LOS_MAX_RANGE, GYM - 1);
+    if (!globallos_num_used)
+        return;
     for (int y = y1; y <= y2; y++)
         for (int x = x1; x <= x2; x++)
-            memset(globallos[x][y], 0, sizeof(halflos_t));
+            _clear_globallos_at(x, y);
 }
 
 void invalidate_los()
 {
+    if (!globallos_num_used)
+        return;
     for (rectangle_iterator ri(0); ri; ++ri)
-        memset(globallos[ri->x][ri->y], 0, sizeof(halflos_t));
+        _clear_globallos_at(ri->x, ri->y);
+}
+
+size_t los_cache_size()
+{
+    return globallos ? sizeof(globallos_t) : 0;
+}
+
+size_t los_cache_used()
+{
+    return globallos_num_used * sizeof(halflos_t);
 }
 
 static void _update_globallos_at(const coord_def& p, los_type l)
@@ -115,6 +181,8 @@ static void _update_globallos_at(const coord_def& p, los_type l)
 
 bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l)
 {
+    PROF_HOT_ZONE("cell_see_cell");
+
     if (l == LOS_NONE)
         return true;
 
@@ -124,7 +192,11 @@ bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l)
         return false; // outside range
 
     if (!(*flags & (l << LOS_KNOWN)))
+    {
         _update_globallos_at(p, l);
+        // The cache may only just have been allocated.
+        flags = _lookup_globallos(p, q);
+    }
 
     //if (!(*flags & (l << LOS_KNOWN)))
     //    die("cell_see_cell %d,%d %d,%d", p.x,p.y,q.x,q.y);
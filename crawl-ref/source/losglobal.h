@@ -6,3 +6,7 @@ void invalidate_los_around(const coord_def& p);
 void invalidate_los();
 
 bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l);
+
+// Bytes allocated for the cache, and the part of them holding anything.
+size_t los_cache_size();
+size_t los_cache_used();
@@ -38,6 +38,7 @@
 #include "artefact.h"
 #include "art-enum.h"
 #include "beam.h"
+#include "bench.h"
 #include "bloodspatter.h"
 #include "branch.h"
 #include "butcher.h"
@@ -100,6 +101,7 @@
 #include "mapmark.h"
 #include "maps.h"
 #include "melee-attack.h"
+#include "memstats.h"
 #include "message.h"
 #include "misc.h"
 #include "mon-abil.h"
@@ -117,6 +119,7 @@
 #include "player.h"
 #include "player-reacts.h"
 #include "player-stats.h"
+#include "profiler.h"
 #include "prompt.h"
 #include "quiver.h"
 #include "random.h"
@@ -318,7 +321,8 @@ int main(int argc, char *argv[])
     // Now parse the args again, looking for everything else.
     parse_args(argc, argv, false);
 
-    if (Options.sc_entries != 0 || !SysEnv.scorefile.empty())
+    if (Options.sc_entries != 0 || !SysEnv.scorefile.empty()
+        || !SysEnv.score_query.empty())
     {
         crawl_state.type = Options.game.type;
         crawl_state.map = crawl_state.sprint_map;
@@ -410,6 +414,11 @@ NORETURN static void _launch_game()
 {
     const bool game_start = startup_step();
 
+#ifdef WIZARD
+    if (!crawl_state.fsim_spec.empty())
+        fsim_batch();
+#endif
+
     // Attach the macro key recorder
     remove_key_recorder(&repeat_again_rec);
     add_key_recorder(&repeat_again_rec);
@@ -532,9 +541,29 @@ static void _show_commandline_options_help()
     puts("  -tscores [N]           terse highscore list");
     puts("  -vscores [N]           verbose highscore list");
     puts("  -scorefile <filename>  scorefile to report on");
+    puts("  -score-query <filter>  only report scores matching a filter such");
+    puts("                         as name=foo,race=Minotaur,v=0.2,");
+    puts("                         since=20200101,until=20201231");
     puts("");
     puts("Arena options: (Stage a tournament between various monsters.)");
     puts("  -arena \"<monster list> v <monster list> arena:<arena map>\"");
+    puts("");
+    puts("Benchmark options: (Time seeded arena fights with no display.)");
+    puts("  -bench                    run every benchmark scenario");
+    puts("  -bench foo,bar            run only scenarios \"foo\" and \"bar\"");
+    puts("  -bench list               list available scenarios");
+    puts("  -bench-baseline <file>    compare against earlier -bench output");
+    puts("  -bench-threshold <N>      fail if N% slower than the baseline "
+         "(default 10)");
+#ifdef WIZARD
+    puts("");
+    puts("Fight simulator options: (Batch runs of the wizard-mode fsim.)");
+    puts("  -fsim <file>              run each line's matchup, and append the "
+         "results");
+    puts("                            to fsim.csv (or fsim.txt)");
+    puts("  -fsim-jobs <N>            run N matchups at once (default: one "
+         "per CPU)");
+#endif
 #ifdef DEBUG_DIAGNOSTICS
     puts("");
     puts("Diagnostic options:");
@@ -565,6 +594,16 @@ static void _show_commandline_options_help()
     puts("  -gdb/-no-gdb     produce gdb backtrace when a crash happens (default:on)");
 #endif
     puts("  -playable-json   list playable species, jobs, and character combos.");
+#ifdef PROFILE_ZONES
+    puts("  -profile <file>  write a zone trace to <file> and per-turn");
+    puts("                   histograms to <file>.hist on exit");
+#endif
+    puts("  -memstats <file> write memory use by subsystem to <file> on exit");
+    puts("  -record <file>   record the game's keys (and seed and options) to");
+    puts("                   <file>; seeds the game if it isn't already, so");
+    puts("                   like any seeded game it loads no ghosts");
+    puts("  -replay <file>   replay a -record file without delays or map");
+    puts("                   drawing, writing timings to <file>.report.json");
 
 #if defined(TARGET_OS_WINDOWS) && defined(USE_TILE_LOCAL)
     text_popup(help, L"Dungeon Crawl command line help");
@@ -693,6 +732,7 @@ static void _set_removed_types_as_identified()
     for (auto entry : removed_items)
         if (item_type_has_ids(entry.first))
             you.type_ids(entry) = true;
+    invalidate_item_names();
 }
 
 #ifdef WIZARD
@@ -782,7 +822,7 @@ static void _do_wizard_command(int wiz_command)
     // case CONTROL('M'): break; // XXX do not use, menu command
 
     // case 'n': break;
-    // case 'N': break;
+    case 'N': wizard_memstats(); break;
     // case CONTROL('N'): break;
 
     case 'o': wizard_create_spec_object(); break;
@@ -830,7 +870,11 @@ static void _do_wizard_command(int wiz_command)
 
     case 'y': wizard_identify_all_items(); break;
     case 'Y': wizard_unidentify_all_items(); break;
+#ifdef PROFILE_ZONES
+    case CONTROL('Y'): wizard_dump_profile(); break;
+#else
     // case CONTROL('Y'): break;
+#endif
 
     case 'z': wizard_cast_spec_spell(); break;
     // case 'Z': break;
@@ -2479,6 +2523,12 @@ void world_reacts()
     // All markers should be activated at this point.
     ASSERT(!env.markers.need_activate());
 
+#ifdef PROFILE_ZONES
+    prof_new_turn();
+#endif
+    PROF_ZONE("world_reacts");
+
+    ++bench_counts.player_turns;
     fire_final_effects();
 
     if (crawl_state.viewport_monster_hp || crawl_state.viewport_weapons)
@@ -55,6 +55,19 @@ struct cloud_info
     killer_type killer;
 };
 
+/*
+ * The info objects hanging off map cells come from free lists rather than
+ * straight from new and delete: show_init() clears and refills every cell
+ * in view each turn, and a released object is usually picked up again by
+ * the very next set_*(), which then assigns into its existing storage.
+ */
+cloud_info *new_map_info(const cloud_info &ci);
+item_info *new_map_info(const item_info &ii);
+monster_info *new_map_info(const monster_info &mi);
+void free_map_info(cloud_info *ci);
+void free_map_info(item_info *ii);
+void free_map_info(monster_info *mi);
+
 /*
  * A map_cell stores what the player knows about a cell.
  * These go in env.map_knowledge.
@@ -70,21 +83,21 @@ struct map_cell
     {
         memcpy(this, &c, sizeof(map_cell));
         if (_cloud)
-            _cloud = new cloud_info(*_cloud);
+            _cloud = new_map_info(*_cloud);
         if (_mons)
-            _mons = new monster_info(*_mons);
+            _mons = new_map_info(*_mons);
         if (_item)
-            _item = new item_info(*_item);
+            _item = new_map_info(*_item);
     }
 
     ~map_cell()
     {
         if (_cloud)
-            delete _cloud;
+            free_map_info(_cloud);
         if (!(flags & MAP_DETECTED_MONSTER) && _mons)
-            delete _mons;
+            free_map_info(_mons);
         if (_item)
-            delete _item;
+            free_map_info(_item);
     }
 
     map_cell& operator=(const map_cell& c)
@@ -92,18 +105,18 @@ struct map_cell
         if (&c == this)
             return *this;
         if (_cloud)
-            delete _cloud;
+            free_map_info(_cloud);
         if (_mons)
-            delete _mons;
+            free_map_info(_mons);
         if (_item)
-            delete _item;
+            free_map_info(_item);
         memcpy(this, &c, sizeof(map_cell));
         if (_cloud)
-            _cloud = new cloud_info(*_cloud);
+            _cloud = new_map_info(*_cloud);
         if (_mons)
-            _mons = new monster_info(*_mons);
+            _mons = new_map_info(*_mons);
         if (_item)
-            _item = new item_info(*_item);
+            _item = new_map_info(*_item);
         return *this;
     }
 
@@ -161,8 +174,11 @@ struct map_cell
 
     void set_item(const item_info& ii, bool more_items)
     {
-        clear_item();
-        _item = new item_info(ii);
+        flags &= ~(MAP_DETECTED_ITEM | MAP_MORE_ITEMS);
+        if (_item)
+            *_item = ii;
+        else
+            _item = new_map_info(ii);
         if (more_items)
             flags |= MAP_MORE_ITEMS;
     }
@@ -173,7 +189,7 @@ struct map_cell
     {
         if (_item)
         {
-            delete _item;
+            free_map_info(_item);
             _item = 0;
         }
         flags &= ~(MAP_DETECTED_ITEM | MAP_MORE_ITEMS);
@@ -194,8 +210,11 @@ struct map_cell
 
     void set_monster(const monster_info& mi)
     {
-        clear_monster();
-        _mons = new monster_info(mi);
+        flags &= ~(MAP_DETECTED_MONSTER | MAP_INVISIBLE_MONSTER);
+        if (_mons)
+            *_mons = mi;
+        else
+            _mons = new_map_info(mi);
     }
 
     bool detected_monster() const
@@ -211,7 +230,7 @@ struct map_cell
     void set_detected_monster(monster_type mons)
     {
         clear_monster();
-        _mons = new monster_info(MONS_SENSED);
+        _mons = new_map_info(monster_info(MONS_SENSED));
         _mons->base_type = mons;
         flags |= MAP_DETECTED_MONSTER;
     }
@@ -225,7 +244,7 @@ struct map_cell
     void clear_monster()
     {
         if (_mons)
-            delete _mons;
+            free_map_info(_mons);
         flags &= ~(MAP_DETECTED_MONSTER | MAP_INVISIBLE_MONSTER);
         _mons = 0;
     }
@@ -254,15 +273,16 @@ struct map_cell
     void set_cloud(const cloud_info& ci)
     {
         if (_cloud)
-            delete _cloud;
-        _cloud = new cloud_info(ci);
+            *_cloud = ci;
+        else
+            _cloud = new_map_info(ci);
     }
 
     void clear_cloud()
     {
         if (_cloud)
         {
-            delete _cloud;
+            free_map_info(_cloud);
             _cloud = 0;
         }
     }
@@ -2,6 +2,7 @@
 
 #include "map-knowledge.h"
 
+#include "bench.h"
 #include "cloud.h"
 #include "coordit.h"
 #include "directn.h"
@@ -161,11 +162,82 @@ void clear_terrain_visibility()
     env.visible.clear();
 }
 
+// More than a screenful of released objects isn't worth keeping.
+#define MAP_INFO_POOL_SIZE 1024
+
+template<class T>
+class map_info_pool
+{
+public:
+    T *get(const T &src)
+    {
+        if (spare.empty())
+        {
+            ++bench_counts.map_info_allocs;
+            return new T(src);
+        }
+
+        T *info = spare.back();
+        spare.pop_back();
+        *info = src;
+        return info;
+    }
+
+    void put(T *info)
+    {
+        if (spare.size() < MAP_INFO_POOL_SIZE)
+            spare.push_back(info);
+        else
+            delete info;
+    }
+
+private:
+    vector<T *> spare;
+};
+
+// Never destroyed, as map cells may still be freed during exit.
+template<class T>
+static map_info_pool<T> &_map_info_pool()
+{
+    static map_info_pool<T> *pool = new map_info_pool<T>;
+    return *pool;
+}
+
+cloud_info *new_map_info(const cloud_info &ci)
+{
+    return _map_info_pool<cloud_info>().get(ci);
+}
+
+item_info *new_map_info(const item_info &ii)
+{
+    return _map_info_pool<item_info>().get(ii);
+}
+
+monster_info *new_map_info(const monster_info &mi)
+{
+    return _map_info_pool<monster_info>().get(mi);
+}
+
+void free_map_info(cloud_info *ci)
+{
+    _map_info_pool<cloud_info>().put(ci);
+}
+
+void free_map_info(item_info *ii)
+{
+    _map_info_pool<item_info>().put(ii);
+}
+
+void free_map_info(monster_info *mi)
+{
+    _map_info_pool<monster_info>().put(mi);
+}
+
 void map_cell::set_detected_item()
 {
     clear_item();
     flags |= MAP_DETECTED_ITEM;
-    _item = new item_info();
+    _item = new_map_info(item_info());
     _item->base_type = OBJ_DETECTED;
     _item->rnd       = 1;
 }
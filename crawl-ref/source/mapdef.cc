@@ -3498,6 +3498,75 @@ int map_def::subvault_mismatch_count(const coord_def &offset) const
 
     return count;
 }
+//////////////////////////////////////////////////////////////////////////
+// Parsed spec caches
+//
+// Each placement of a vault runs its Lua again, and so parses its MONS,
+// ITEM and KFEAT lines again from the same strings. Parsing doesn't
+// randomise anything (that happens when a monster, item or feature is
+// picked from the parsed slot) except when a zombie base monster or deck
+// type is given as random; such parses set spec_parse_uncacheable, and
+// their results aren't kept.
+
+// Plenty for every spec in the game; a long run of map generation won't
+// grow the caches past this.
+#define SPEC_CACHE_MAX 16384
+
+static bool spec_parse_uncacheable = false;
+
+static spec_cache_counts mons_cache_counts = { "MONS", 0, 0, 0 };
+static spec_cache_counts item_cache_counts = { "ITEM", 0, 0, 0 };
+static spec_cache_counts feat_cache_counts = { "KFEAT", 0, 0, 0 };
+
+vector<spec_cache_counts> spec_cache_stats()
+{
+    return { mons_cache_counts, item_cache_counts, feat_cache_counts };
+}
+
+template <typename T>
+class spec_cache
+{
+public:
+    spec_cache(spec_cache_counts &counts_) : counts(counts_), entries() { }
+
+    // Returns what parse() returned for spec, and sets err to what it left
+    // in the error string, calling it only if spec isn't cached.
+    template <typename P>
+    T get(const string &spec, string &err, P parse)
+    {
+        auto found = entries.find(spec);
+        if (found != entries.end())
+        {
+            counts.hits++;
+            err = found->second.second;
+            return found->second.first;
+        }
+
+        // Item specs are parsed inside shop features, so keep any outer
+        // parse's flag.
+        const bool outer_uncacheable = spec_parse_uncacheable;
+        spec_parse_uncacheable = false;
+        T result = parse();
+        const bool uncacheable = spec_parse_uncacheable;
+        spec_parse_uncacheable = outer_uncacheable || uncacheable;
+
+        if (uncacheable)
+            counts.uncacheable++;
+        else
+        {
+            counts.misses++;
+            if (entries.size() >= SPEC_CACHE_MAX)
+                entries.clear();
+            entries.emplace(spec, make_pair(result, err));
+        }
+        return result;
+    }
+
+private:
+    spec_cache_counts &counts;
+    map<string, pair<T, string>> entries;
+};
+
 
 ///////////////////////////////////////////////////////////////////
 // mons_list
@@ -3704,6 +3773,13 @@ mon_enchant mons_list::parse_ench(string &ench_str, bool perm)
 }
 
 mons_list::mons_spec_slot mons_list::parse_mons_spec(string spec)
+{
+    static spec_cache<mons_spec_slot> cache(mons_cache_counts);
+    return cache.get(spec, error,
+                     [&]() { return parse_mons_spec_uncached(spec); });
+}
+
+mons_list::mons_spec_slot mons_list::parse_mons_spec_uncached(string spec)
 {
     mons_spec_slot slot;
 
@@ -4159,6 +4235,10 @@ static monster_type _fixup_mon_type(monster_type orig)
     if (orig < 0)
         orig = MONS_PROGRAM_BUG;
 
+    // The spec now depends on a random draw (and the current level).
+    if (needs_resolution(orig))
+        spec_parse_uncacheable = true;
+
     monster_type dummy_mons = MONS_PROGRAM_BUG;
     coord_def dummy_pos;
     dungeon_char_type dummy_feat;
@@ -5133,7 +5213,10 @@ void item_list::build_deck_spec(string s, item_spec* spec)
         spec->sub_type = sub_type;
     }
     else
+    {
         spec->sub_type = random_deck_type();
+        spec_parse_uncacheable = true;
+    }
 }
 
 bool item_list::parse_single_spec(item_spec& result, string s)
@@ -5630,6 +5713,13 @@ void item_list::parse_raw_name(string name, item_spec &spec)
 }
 
 item_list::item_spec_slot item_list::parse_item_spec(string spec)
+{
+    static spec_cache<item_spec_slot> cache(item_cache_counts);
+    return cache.get(spec, error,
+                     [&]() { return parse_item_spec_uncached(spec); });
+}
+
+item_list::item_spec_slot item_list::parse_item_spec_uncached(string spec)
 {
     // lowercase(spec);
 
@@ -5885,16 +5975,19 @@ void keyed_mapspec::copy_feat(const keyed_mapspec &spec)
 
 void keyed_mapspec::parse_features(const string &s)
 {
-    feat.feats.clear();
-    for (const string &spec : split_string("/", s))
+    static spec_cache<feature_spec_list> cache(feat_cache_counts);
+    feat.feats = cache.get(s, err, [&]()
     {
-        feature_spec_list feats = parse_feature(spec);
-        if (!err.empty())
-            return;
-        feat.feats.insert(feat.feats.end(),
-                           feats.begin(),
-                           feats.end());
-    }
+        feature_spec_list all;
+        for (const string &spec : split_string("/", s))
+        {
+            feature_spec_list feats = parse_feature(spec);
+            if (!err.empty())
+                break;
+            all.insert(all.end(), feats.begin(), feats.end());
+        }
+        return all;
+    });
 }
 
 /**
@@ -624,6 +624,7 @@ private:
 private:
     item_spec item_by_specifier(const string &spec);
     item_spec_slot parse_item_spec(string spec);
+    item_spec_slot parse_item_spec_uncached(string spec);
     void build_deck_spec(string s, item_spec* spec);
     bool parse_single_spec(item_spec &result, string s);
     int parse_acquirement_source(const string &source);
@@ -740,6 +741,7 @@ private:
     mons_spec get_zombified_monster(const string &name,
                                     monster_type zomb) const;
     mons_spec_slot parse_mons_spec(string spec);
+    mons_spec_slot parse_mons_spec_uncached(string spec);
     void parse_mons_spells(mons_spec &slot, vector<string> &spells);
     mon_enchant parse_ench(string &ench_str, bool perm);
     mons_spec pick_monster(mons_spec_slot &slot);
@@ -1325,3 +1327,14 @@ const char *map_section_name(int msect);
 int store_tilename_get_index(const string& tilename);
 
 int str_to_ego(object_class_type item_type, string ego_str);
+
+// How often the parsed forms of MONS, ITEM and KFEAT specs were reused.
+struct spec_cache_counts
+{
+    const char *kind;
+    int hits;
+    int misses;
+    int uncacheable;    // Parses that resolved something random.
+};
+
+vector<spec_cache_counts> spec_cache_stats();
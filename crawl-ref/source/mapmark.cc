@@ -11,7 +11,6 @@
 
 #include "beh-type.h"
 #include "cluautil.h"
-#include "coordit.h"
 #include "dlua.h"
 #include "end.h"
 #include "env.h"
@@ -943,12 +942,15 @@ string map_position_marker::debug_describe() const
 //////////////////////////////////////////////////////////////////////////
 // Map markers in env.
 
-map_markers::map_markers() : markers(), have_inactive_markers(false)
+map_markers::map_markers()
+  : markers(), markers_by_type(), property_markers(),
+    have_inactive_markers(false)
 {
 }
 
 map_markers::map_markers(const map_markers &c)
-  : markers(), have_inactive_markers(false)
+  : markers(), markers_by_type(), property_markers(),
+    have_inactive_markers(false)
 {
     init_from(c);
 }
@@ -1015,11 +1017,21 @@ void map_markers::activate_markers_at(coord_def p)
 
 void map_markers::add(map_marker *marker)
 {
-    markers.insert(dgn_pos_marker(marker->pos, marker));
+    link_marker(marker);
     have_inactive_markers = true;
 }
 
-void map_markers::unlink_marker(const map_marker *marker)
+void map_markers::link_marker(map_marker *marker)
+{
+    const dgn_pos_marker entry(marker->pos, marker);
+    markers.insert(entry);
+    markers_by_type[marker->get_type()].insert(entry);
+    if (marker->has_properties())
+        property_markers.insert(entry);
+}
+
+static void _erase_marker(multimap<coord_def, map_marker *> &markers,
+                          const map_marker *marker)
 {
     auto els = markers.equal_range(marker->pos);
     for (auto i = els.first; i != els.second; ++i)
@@ -1032,6 +1044,14 @@ void map_markers::unlink_marker(const map_marker *marker)
     }
 }
 
+void map_markers::unlink_marker(const map_marker *marker)
+{
+    _erase_marker(markers, marker);
+    _erase_marker(markers_by_type[marker->get_type()], marker);
+    if (marker->has_properties())
+        _erase_marker(property_markers, marker);
+}
+
 void map_markers::check_empty()
 {
     if (markers.empty())
@@ -1052,10 +1072,14 @@ void map_markers::remove_markers_at(const coord_def &c,
     for (auto i = els.first; i != els.second;)
     {
         auto todel = i++;
-        if (type == MAT_ANY || todel->second->get_type() == type)
+        map_marker *marker = todel->second;
+        if (type == MAT_ANY || marker->get_type() == type)
         {
-            delete todel->second;
+            _erase_marker(markers_by_type[marker->get_type()], marker);
+            if (marker->has_properties())
+                _erase_marker(property_markers, marker);
             markers.erase(todel);
+            delete marker;
         }
     }
     check_empty();
@@ -1072,11 +1096,9 @@ map_marker *map_markers::find(const coord_def &c, map_marker_type type)
 
 map_marker *map_markers::find(map_marker_type type)
 {
-    for (const auto &entry : markers)
-        if (type == MAT_ANY || entry.second->get_type() == type)
-            return entry.second;
-
-    return nullptr;
+    const dgn_marker_map &bucket =
+        type == MAT_ANY ? markers : markers_by_type[type];
+    return bucket.empty() ? nullptr : bucket.begin()->second;
 }
 
 void map_markers::move(const coord_def &from, const coord_def &to)
@@ -1085,12 +1107,11 @@ void map_markers::move(const coord_def &from, const coord_def &to)
     auto els = markers.equal_range(from);
 
     list<map_marker*> tmarkers;
-    for (auto i = els.first; i != els.second;)
-    {
-        auto curr = i++;
-        tmarkers.push_back(curr->second);
-        markers.erase(curr);
-    }
+    for (auto i = els.first; i != els.second; ++i)
+        tmarkers.push_back(i->second);
+
+    for (auto mark : tmarkers)
+        unlink_marker(mark);
 
     for (auto mark : tmarkers)
     {
@@ -1109,12 +1130,12 @@ void map_markers::move_marker(map_marker *marker, const coord_def &to)
 
 vector<map_marker*> map_markers::get_all(map_marker_type mat)
 {
+    const dgn_marker_map &bucket =
+        mat == MAT_ANY ? markers : markers_by_type[mat];
     vector<map_marker*> rmarkers;
-    for (const auto &entry : markers)
-    {
-        if (mat == MAT_ANY || entry.second->get_type() == mat)
-            rmarkers.push_back(entry.second);
-    }
+    rmarkers.reserve(bucket.size());
+    for (const auto &entry : bucket)
+        rmarkers.push_back(entry.second);
     return rmarkers;
 }
 
@@ -1122,7 +1143,8 @@ vector<map_marker*> map_markers::get_all(const string &key, const string &val)
 {
     vector<map_marker*> rmarkers;
 
-    for (const auto &entry : markers)
+    // Markers without properties would only ever return "".
+    for (const auto &entry : property_markers)
     {
         map_marker*  marker = entry.second;
         const string prop   = marker->property(key);
@@ -1143,10 +1165,27 @@ vector<map_marker*> map_markers::get_markers_at(const coord_def &c)
     return rmarkers;
 }
 
+// All the markers that have properties, in the order that scanning the map
+// row by row and calling get_markers_at() on each square would find them.
+vector<map_marker*> map_markers::get_property_markers_by_row() const
+{
+    vector<map_marker*> rmarkers;
+    rmarkers.reserve(property_markers.size());
+    for (const auto &entry : property_markers)
+        rmarkers.push_back(entry.second);
+    stable_sort(rmarkers.begin(), rmarkers.end(),
+                [](const map_marker *a, const map_marker *b)
+                {
+                    return a->pos.y < b->pos.y
+                           || (a->pos.y == b->pos.y && a->pos.x < b->pos.x);
+                });
+    return rmarkers;
+}
+
 string map_markers::property_at(const coord_def &c, map_marker_type type,
                                 const string &key)
 {
-    auto els = markers.equal_range(c);
+    auto els = property_markers.equal_range(c);
     for (auto i = els.first; i != els.second; ++i)
     {
         const string &prop = i->second->property(key);
@@ -1161,6 +1200,9 @@ void map_markers::clear()
     for (auto &entry : markers)
         delete entry.second;
     markers.clear();
+    for (auto &bucket : markers_by_type)
+        bucket.clear();
+    property_markers.clear();
     check_empty();
 }
 
@@ -1228,12 +1270,22 @@ vector<coord_def> find_marker_positions_by_prop(const string &prop,
                                                 unsigned maxresults)
 {
     vector<coord_def> marker_positions;
-    for (rectangle_iterator i(0, 0); i; ++i)
+    // As property_at() on every square: only the first marker on a square
+    // with a value for prop counts.
+    coord_def last(-1, -1);
+    for (map_marker *mark : env.markers.get_property_markers_by_row())
     {
-        const string value = env.markers.property_at(*i, MAT_ANY, prop);
-        if (!value.empty() && (expected.empty() || value == expected))
+        if (mark->pos == last)
+            continue;
+
+        const string value = mark->property(prop);
+        if (value.empty())
+            continue;
+
+        last = mark->pos;
+        if (expected.empty() || value == expected)
         {
-            marker_positions.push_back(*i);
+            marker_positions.push_back(mark->pos);
             if (maxresults && marker_positions.size() >= maxresults)
                 return marker_positions;
         }
@@ -1246,17 +1298,14 @@ vector<map_marker*> find_markers_by_prop(const string &prop,
                                          unsigned maxresults)
 {
     vector<map_marker*> markers;
-    for (rectangle_iterator pos(0, 0); pos; ++pos)
+    for (map_marker *mark : env.markers.get_property_markers_by_row())
     {
-        for (map_marker *mark : env.markers.get_markers_at(*pos))
+        const string value(mark->property(prop));
+        if (!value.empty() && (expected.empty() || value == expected))
         {
-            const string value(mark->property(prop));
-            if (!value.empty() && (expected.empty() || value == expected))
-            {
-                markers.push_back(mark);
-                if (maxresults && markers.size() >= maxresults)
-                    return markers;
-            }
+            markers.push_back(mark);
+            if (maxresults && markers.size() >= maxresults)
+                return markers;
         }
     }
     return markers;
@@ -61,6 +61,9 @@ public:
     virtual void read(reader &);
     virtual string debug_describe() const = 0;
     virtual string property(const string &pname) const;
+    // Whether property() can return anything but "". Markers that can't
+    // are left out of map_markers' property index.
+    virtual bool has_properties() const { return false; }
 
     static map_marker *read_marker(reader &);
     /// @throws bad_map_marker if text could not be parsed.
@@ -275,6 +278,7 @@ public:
     map_marker *clone() const override;
     string debug_describe() const override;
     string property(const string &pname) const override;
+    bool has_properties() const override { return true; }
 
     bool notify_dgn_event(const dgn_event &e) override;
 
@@ -304,6 +308,7 @@ public:
     void read(reader &) override;
     string debug_describe() const override;
     string property(const string &pname) const override;
+    bool has_properties() const override { return true; }
     string set_property(const string &key, const string &val);
     map_marker *clone() const override;
     static map_marker *read(reader &, map_marker_type);
@@ -1160,6 +1160,21 @@ int map_count()
     return vdefs.size();
 }
 
+// Roughly what the loaded index of maps takes up: the map_defs themselves
+// and their names, tags and placement strings. Map bodies are only loaded
+// while a map is being placed.
+size_t map_index_size()
+{
+    size_t size = vdefs.capacity() * sizeof(map_def);
+    for (const map_def &map : vdefs)
+    {
+        size += map.name.capacity() + map.tags.capacity()
+                + map.description.capacity()
+                + map.place_loaded_from.filename.capacity();
+    }
+    return size;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Reading maps from .des files.
 
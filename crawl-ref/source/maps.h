@@ -27,6 +27,7 @@ coord_def find_portal_place(const vault_placement *place, bool check_place);
 const map_def *map_by_index(int index);
 void strip_all_maps();
 int map_count();
+size_t map_index_size();
 
 string vault_chance_tag(const map_def &map);
 
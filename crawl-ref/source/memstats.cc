@@ -0,0 +1,132 @@
+/**
+ * @file
+ * @brief Memory accounting by subsystem (-memstats, and a wizard command).
+ *
+ * The fixed-size parts of the game state are counted by their sizes, and
+ * the Lua states and map index by what they report or hold. Those don't
+ * add up to the process's RSS (the C++ heap, the text databases and the
+ * binary itself aren't broken down), but they show where the big fixed
+ * costs are.
+**/
+
+#include "AppHdr.h"
+
+#include "memstats.h"
+
+#include <cstdio>
+#ifndef TARGET_OS_WINDOWS
+# include <sys/resource.h>
+#endif
+
+#include "clua.h"
+#include "dlua.h"
+#include "env.h"
+#include "losglobal.h"
+#include "maps.h"
+#include "message.h"
+#include "player.h"
+#include "stringutil.h"
+#include "syscalls.h"
+
+// Current and peak resident set size in kilobytes, or 0 where the system
+// doesn't tell us.
+static void _process_rss_kb(long &rss, long &peak)
+{
+    rss = peak = 0;
+#ifdef TARGET_OS_LINUX
+    if (FILE *f = fopen("/proc/self/status", "r"))
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), f))
+        {
+            if (starts_with(line, "VmRSS:"))
+                rss = atol(line + 6);
+            else if (starts_with(line, "VmHWM:"))
+                peak = atol(line + 6);
+        }
+        fclose(f);
+    }
+#endif
+#ifndef TARGET_OS_WINDOWS
+    if (!peak)
+    {
+        struct rusage usage;
+        if (!getrusage(RUSAGE_SELF, &usage))
+        {
+# ifdef TARGET_OS_MACOSX
+            peak = usage.ru_maxrss / 1024; // bytes, not kilobytes
+# else
+            peak = usage.ru_maxrss;
+# endif
+        }
+    }
+#endif
+}
+
+static string _memstat_line(const char *what, size_t bytes,
+                            const string &note = "")
+{
+    return make_stringf("%-24s %10.1f KB%s%s\n", what, bytes / 1024.0,
+                        note.empty() ? "" : "  ", note.c_str());
+}
+
+string memstats_report()
+{
+    string report;
+
+    long rss, peak;
+    _process_rss_kb(rss, peak);
+    report += make_stringf("%-24s %10ld KB\n", "process RSS", rss);
+    report += make_stringf("%-24s %10ld KB\n", "peak RSS", peak);
+    report += "\n";
+
+    report += _memstat_line("items", sizeof(env.item),
+                            make_stringf("%d slots", MAX_ITEMS));
+    report += _memstat_line("monsters", sizeof(env.mons),
+                            make_stringf("%d slots", MAX_MONSTERS + 2));
+
+    const size_t grids = sizeof(env.grid) + sizeof(env.pgrid)
+                         + sizeof(env.mgrid) + sizeof(env.igrid)
+                         + sizeof(env.grid_colours)
+                         + sizeof(env.level_map_mask)
+                         + sizeof(env.level_map_ids)
+                         + sizeof(env.map_seen) + sizeof(env.tile_flv);
+    report += _memstat_line("level grids", grids);
+    report += _memstat_line("map knowledge", sizeof(env.map_knowledge)
+                            + (env.map_forgotten ? sizeof(MapKnowledge) : 0));
+#ifdef USE_TILE
+    const size_t tile_grids = sizeof(env.tile_bk_fg) + sizeof(env.tile_bk_bg)
+                         + sizeof(env.tile_bk_cloud) + sizeof(env.tile_fg)
+                         + sizeof(env.tile_bg) + sizeof(env.tile_cloud);
+    report += _memstat_line("level tiles", tile_grids);
+#endif
+    report += _memstat_line("player", sizeof(you));
+
+    report += _memstat_line("LOS cache", los_cache_size(),
+                            make_stringf("%.1f KB in use",
+                                         los_cache_used() / 1024.0));
+    report += _memstat_line("map index", map_index_size(),
+                            make_stringf("%d maps", map_count()));
+    report += _memstat_line("Lua (user)", clua.memory_used);
+    report += _memstat_line("Lua (dungeon)", dlua.memory_used);
+
+    return report;
+}
+
+bool memstats_dump(const string &file)
+{
+    FILE *f = fopen_u(file.c_str(), "w");
+    if (!f)
+        return false;
+    fprintf(f, "%s", memstats_report().c_str());
+    fclose(f);
+    return true;
+}
+
+#ifdef WIZARD
+void wizard_memstats()
+{
+    for (const string &line : split_string("\n", memstats_report(), false))
+        mpr(line);
+}
+#endif
@@ -0,0 +1,13 @@
+/**
+ * @file
+ * @brief Memory accounting by subsystem (-memstats, and a wizard command).
+**/
+
+#pragma once
+
+string memstats_report();
+bool memstats_dump(const string &file);
+
+#ifdef WIZARD
+void wizard_memstats();
+#endif
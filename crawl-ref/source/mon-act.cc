@@ -11,6 +11,7 @@
 #include "areas.h"
 #include "arena.h"
 #include "attitude-change.h"
+#include "bench.h"
 #include "bloodspatter.h"
 #include "butcher.h"
 #include "cloud.h"
@@ -50,6 +51,7 @@
 #include "mon-speak.h"
 #include "mon-tentacle.h"
 #include "nearby-danger.h"
+#include "profiler.h"
 #include "religion.h"
 #include "rot.h"
 #include "shout.h"
@@ -1549,6 +1551,9 @@ void handle_monster_move(monster* mons)
     if (!entry)
         return;
 
+    PROF_ZONE("handle_monster_move");
+    ++bench_counts.monster_turns;
+
     const bool disabled = crawl_state.disables[DIS_MON_ACT]
                           && _unfriendly_or_insane(*mons);
 
@@ -2351,6 +2356,8 @@ static void _update_monster_attitude(monster *mon)
  */
 void handle_monsters(bool with_noise)
 {
+    PROF_ZONE("handle_monsters");
+
     for (monster_iterator mi; mi; ++mi)
     {
         _pre_monster_move(**mi);
@@ -3983,6 +3983,10 @@ static mon_spell_slot _choose_spell_to_cast(monster &mons,
 
     bolt orig_beem = beem;
 
+    // Nothing changes on the map while the monster makes up its mind, so
+    // the tracers it fires can share rays.
+    tracer_ray_cache rays;
+
     // Promote the casting of useful spells for low-HP monsters.
     // (kraken should always cast their escape spell of inky).
     if (_mons_in_emergency(mons)
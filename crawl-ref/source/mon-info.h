@@ -248,12 +248,23 @@ struct monster_info : public monster_info_base
         }
     }
 
+    // Assigns member by member, so that strings, props and items reuse
+    // the storage they already have.
     monster_info& operator=(const monster_info& p)
     {
         if (this != &p)
         {
-            this->~monster_info();
-            new (this) monster_info(p);
+            monster_info_base::operator=(p);
+            i_ghost = p.i_ghost;
+            for (unsigned i = 0; i <= MSLOT_LAST_VISIBLE_SLOT; ++i)
+            {
+                if (!p.inv[i])
+                    inv[i].reset();
+                else if (inv[i])
+                    *inv[i] = *p.inv[i];
+                else
+                    inv[i].reset(new item_def(*p.inv[i]));
+            }
         }
         return *this;
     }
@@ -2,11 +2,13 @@
 
 #include "mon-pathfind.h"
 
+#include "bench.h"
 #include "directn.h"
 #include "env.h"
 #include "los.h"
 #include "mon-movetarget.h"
 #include "mon-place.h"
+#include "profiler.h"
 #include "religion.h"
 #include "state.h"
 #include "terrain.h"
@@ -132,6 +134,9 @@ bool monster_pathfind::init_pathfind(coord_def src, coord_def dest, bool diag,
 
 bool monster_pathfind::start_pathfind(bool msg)
 {
+    PROF_ZONE("monster_pathfind");
+    ++bench_counts.pathfinds;
+
     // NOTE: We never do any traversable() check for the target square.
     //       This means that even if the target cannot be reached
     //       we may still find a path leading adjacent to this position, which
@@ -374,6 +374,7 @@ static void _give_basic_knowledge()
 
     // Recognisable by appearance.
     you.type_ids[OBJ_POTIONS][POT_BLOOD] = true;
+    invalidate_item_names();
 
     // Removed item types are handled in _set_removed_types_as_identified.
 }
@@ -577,4 +578,5 @@ static void _setup_generic(const newgame_def& ng)
     else
         you.save = new package(get_savedir_filename(you.your_name).c_str(),
                                true, true);
+    you.save->enable_async();
 }
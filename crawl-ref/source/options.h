@@ -401,6 +401,8 @@ public:
     bool        restart_after_game; // If true, Crawl will not close on game-end
     bool        restart_after_save; // .. or on save
 
+    bool        pregen_levels;      // Build adjacent levels in the background
+
     bool        read_persist_options; // If true, Crawl will try to load
                                       // options from c_persist.options
 
@@ -16,6 +16,11 @@ Notes:
 * Readers always get the last complete (but not necessarily committed) write
   (ie, READ_UNCOMMITTED) at the time they started; it is safe to continue
   reading even if the chunk has been changed since.
+* With enable_async(), chunks handed over through write_async() and commits
+  are compressed and written in order by a background thread. Everything
+  the package shares with that thread is guarded by a lock, and reading or
+  deleting a chunk first waits for any pending write of that same chunk.
+  A crash loses whatever hadn't been committed yet, same as without it.
 */
 
 #include "AppHdr.h"
@@ -25,6 +30,7 @@ Notes:
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <sstream>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -35,6 +41,9 @@ Notes:
 #include "errors.h"
 #include "syscalls.h"
 #include "libutil.h" // map_find
+#ifdef ASYNC_SAVE
+#include "threads.h"
+#endif
 
 // debugging defines
 #undef  FSCK_VERBOSE
@@ -73,6 +82,49 @@ struct block_header
     plen_t next;
 };
 
+#ifdef ASYNC_SAVE
+struct async_job
+{
+    bool commit;
+    string name;
+    vector<unsigned char> data; // uncompressed
+};
+
+struct package_async
+{
+    thread_t thread;
+    mutex_t lock;
+    cond_t wake;  // work was queued, or it's time to quit
+    cond_t idle;  // a job has been finished
+    deque<async_job> queue;
+    map<string, int> pending; // queued or in-progress writes, per chunk
+    bool busy;
+    bool quit;
+    string error;
+};
+
+// Holds the package's lock, if it has a background writer.
+class package_guard
+{
+public:
+    package_guard(package_async *a) : async(a)
+    {
+        if (async)
+            mutex_lock(async->lock);
+    }
+    ~package_guard()
+    {
+        if (async)
+            mutex_unlock(async->lock);
+    }
+private:
+    package_async *async;
+};
+#define PACKAGE_GUARD(pkg) package_guard _guard((pkg)->async)
+#else
+#define PACKAGE_GUARD(pkg) do {} while (0)
+#endif
+
 typedef map<string, plen_t> directory_t;
 typedef pair<plen_t, plen_t> bm_p;
 typedef map<plen_t, bm_p> bm_t;
@@ -83,6 +135,9 @@ package::package(const char* file, bool writeable, bool empty)
 #ifdef DO_FSYNC
     , tmp(false)
 #endif
+#ifdef ASYNC_SAVE
+    , async(nullptr)
+#endif
 {
     dprintf("package: initializing file=\"%s\" rw=%d\n", file, writeable);
     ASSERT(writeable || !empty);
@@ -130,6 +185,9 @@ package::package()
 #ifdef DO_FSYNC
     , tmp(true)
 #endif
+#ifdef ASYNC_SAVE
+    , async(nullptr)
+#endif
 {
     dprintf("package: initializing tmp file\n");
     filename = "[tmp]";
@@ -202,6 +260,28 @@ void package::load_traces()
 package::~package()
 {
     dprintf("package: finalizing\n");
+#ifdef ASYNC_SAVE
+    if (async)
+    {
+        // The writer finishes whatever is still queued before it quits.
+        mutex_lock(async->lock);
+        async->quit = true;
+        cond_wake(async->wake);
+        mutex_unlock(async->lock);
+        thread_join(async->thread);
+
+        // After a failed background write, the last good commit is all we
+        // can vouch for.
+        if (!async->error.empty())
+            aborted = true;
+
+        cond_destroy(async->wake);
+        cond_destroy(async->idle);
+        mutex_destroy(async->lock);
+        delete async;
+        async = nullptr;
+    }
+#endif
     ASSERT(!n_users || CrawlIsCrashing); // not merely aborted, there are
         // live pointers to us. With normal stack unwinding, destructors
         // will make sure this never happens and this assert is good for
@@ -228,35 +308,84 @@ package::~package()
 void package::commit()
 {
     ASSERT(rw);
-    if (!dirty)
+#ifdef ASYNC_SAVE
+    if (async)
+    {
+        async_check_error();
+        ASSERT(!aborted);
+
+        async_job job;
+        job.commit = true;
+        mutex_lock(async->lock);
+        async->queue.push_back(move(job));
+        cond_wake(async->wake);
+        mutex_unlock(async->lock);
         return;
-    ASSERT(!aborted);
+    }
+#endif
+    commit_now();
+}
+
+/**
+ * Write the directory and point the header at it.
+ *
+ * On a package with a background writer, only writing the directory and
+ * the header holds the lock; the fdatasync()s run without it, so the game
+ * can go on reading chunks while they wait on the disk. Anything written
+ * or deleted meanwhile belongs to the next commit: chunks the new
+ * directory refers to count as committed from the start, so deleting one
+ * only unlinks it, and only chains unlinked before the directory was
+ * written are freed at the end.
+ */
+void package::commit_now()
+{
+    file_header head;
+    vector<plen_t> released;
+    {
+        PACKAGE_GUARD(this);
+        // A queued commit can find the package aborted by the time it runs.
+        if (!dirty || aborted)
+            return;
 
 #ifdef COSTLY_ASSERTS
-    fsck();
+        fsck();
 #endif
 
-    file_header head;
-    head.magic = htole(PACKAGE_MAGIC);
-    head.version = PACKAGE_VERSION;
-    memset(&head.padding, 0, sizeof(head.padding));
-    head.start = htole(write_directory());
+        head.magic = htole(PACKAGE_MAGIC);
+        head.version = PACKAGE_VERSION;
+        memset(&head.padding, 0, sizeof(head.padding));
+        head.start = htole(write_directory());
+        new_chunks.clear();
+        released.swap(unlinked_blocks);
+        dirty = false;
+    }
 #ifdef DO_FSYNC
     // We need a barrier before updating the link to point at the new directory.
     if (!tmp && fdatasync(fd))
         sysfail("flush error while saving");
 #endif
-    seek(0);
-    if (write(fd, &head, sizeof(head)) != sizeof(head))
-        sysfail("write error while saving");
+    {
+        PACKAGE_GUARD(this);
+        if (aborted)
+            return;
+        seek(0);
+        if (write(fd, &head, sizeof(head)) != sizeof(head))
+            sysfail("write error while saving");
+    }
 #ifdef DO_FSYNC
     if (!tmp && fdatasync(fd))
         sysfail("flush error while saving");
 #endif
 
-    new_chunks.clear();
+    PACKAGE_GUARD(this);
+    if (aborted)
+        return;
+    // Chains unlinked since the directory was written are still in it.
+    vector<plen_t> later;
+    later.swap(unlinked_blocks);
+    unlinked_blocks.swap(released);
     collect_blocks();
-    dirty = false;
+    unlinked_blocks.insert(unlinked_blocks.end(), later.begin(), later.end());
 
 #ifdef COSTLY_ASSERTS
     fsck();
@@ -275,11 +404,15 @@ void package::seek(plen_t to)
 
 chunk_writer* package::writer(const string &name)
 {
+    // Don't let a pending write of the same chunk land on top of this one.
+    wait_for_chunk(name);
     return new chunk_writer(this, name);
 }
 
 chunk_reader* package::reader(const string &name)
 {
+    wait_for_chunk(name);
+    PACKAGE_GUARD(this);
     if (plen_t *ch = map_find(directory, name))
         return new chunk_reader(this, *ch);
     return 0;
@@ -378,6 +511,8 @@ void package::free_chunk(const string &name)
 
 void package::delete_chunk(const string &name)
 {
+    wait_for_chunk(name);
+    PACKAGE_GUARD(this);
     free_chunk(name);
     directory.erase(name);
 }
@@ -558,11 +693,17 @@ void package::read_directory(plen_t start, uint8_t version)
 
 bool package::has_chunk(const string &name)
 {
-    return !name.empty() && directory.count(name);
+    if (name.empty())
+        return false;
+    wait_for_chunk(name);
+    PACKAGE_GUARD(this);
+    return directory.count(name);
 }
 
 vector<string> package::list_chunks()
 {
+    flush();
+    PACKAGE_GUARD(this);
     vector<string> list;
     list.reserve(directory.size());
     for (const auto &entry : directory)
@@ -613,11 +754,21 @@ void package::abort()
     // Disable any further operations, allow a shutdown. All errors past
     // this point are ignored (assuming we already failed). All writes since
     // the last commit() are lost.
+    PACKAGE_GUARD(this);
     aborted = true;
+#ifdef ASYNC_SAVE
+    if (async)
+    {
+        async->queue.clear();
+        async->pending.clear();
+        cond_wake(async->idle);
+    }
+#endif
 }
 
 void package::unlink()
 {
+    PACKAGE_GUARD(this);
     abort();
     close(fd);
     fd = -1;
@@ -627,6 +778,8 @@ void package::unlink()
 // the amount of free space not at the end of file
 plen_t package::get_slack()
 {
+    flush();
+    PACKAGE_GUARD(this);
     load_traces();
 
     plen_t slack = 0;
@@ -637,6 +790,8 @@ plen_t package::get_slack()
 
 plen_t package::get_chunk_fragmentation(const string &name)
 {
+    flush();
+    PACKAGE_GUARD(this);
     load_traces();
     ASSERT(directory.count(name)); // not has_chunk(), "" is valid
     plen_t frags = 0;
@@ -653,6 +808,8 @@ plen_t package::get_chunk_fragmentation(const string &name)
 
 plen_t package::get_chunk_compressed_length(const string &name)
 {
+    flush();
+    PACKAGE_GUARD(this);
     load_traces();
     ASSERT(directory.count(name)); // not has_chunk(), "" is valid
     plen_t len = 0;
@@ -667,8 +824,218 @@ plen_t package::get_chunk_compressed_length(const string &name)
     return len;
 }
 
-chunk_writer::chunk_writer(package *parent, const string &_name)
-    : first_block(0), cur_block(0), block_len(0)
+/**
+ * Hand chunk writes and commits over to a background thread from now on.
+ * Without thread support (or if the thread can't be started) the package
+ * just stays synchronous.
+ */
+void package::enable_async()
+{
+#ifdef ASYNC_SAVE
+    ASSERT(rw);
+    if (async)
+        return;
+
+    package_async *a = new package_async();
+    mutex_init(a->lock);
+    cond_init(a->wake);
+    cond_init(a->idle);
+    async = a;
+    if (thread_create_joinable(&a->thread, async_main, this))
+    {
+        dprintf("package: no background writer, saving synchronously\n");
+        async = nullptr;
+        cond_destroy(a->wake);
+        cond_destroy(a->idle);
+        mutex_destroy(a->lock);
+        delete a;
+    }
+#endif
+}
+
+bool package::is_async() const
+{
+#ifdef ASYNC_SAVE
+    return async;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Write a whole chunk at once. On an async package this takes data over
+ * (leaving it empty) and returns straight away; compressing and writing
+ * it happens in the background.
+ */
+void package::write_async(const string &name, vector<unsigned char> &data)
+{
+    // Writes to an aborted package are lost anyway; a writer destroyed
+    // after abort() ends up here.
+    if (aborted)
+    {
+        data.clear();
+        return;
+    }
+#ifdef ASYNC_SAVE
+    if (async)
+    {
+        // Writers call this from their destructors, so any earlier error is
+        // left for the next commit or read to report.
+        async_job job;
+        job.commit = false;
+        job.name = name;
+        job.data.swap(data);
+        mutex_lock(async->lock);
+        async->pending[name]++;
+        async->queue.push_back(move(job));
+        cond_wake(async->wake);
+        mutex_unlock(async->lock);
+        return;
+    }
+#endif
+    chunk_writer out(this, name);
+    if (!data.empty())
+        out.write(data.data(), data.size());
+}
+
+// Wait until every write and commit queued so far has landed.
+void package::flush()
+{
+#ifdef ASYNC_SAVE
+    if (!async)
+        return;
+
+    mutex_lock(async->lock);
+    while (async->busy || !async->queue.empty())
+        cond_wait(async->idle, async->lock);
+    mutex_unlock(async->lock);
+    async_check_error();
+#endif
+}
+
+// Wait until no write of the named chunk is pending.
+void package::wait_for_chunk(const string &name)
+{
+#ifdef ASYNC_SAVE
+    if (!async)
+        return;
+
+    mutex_lock(async->lock);
+    while (async->pending.count(name))
+        cond_wait(async->idle, async->lock);
+    mutex_unlock(async->lock);
+    async_check_error();
+#else
+    UNUSED(name);
+#endif
+}
+
+#ifdef ASYNC_SAVE
+void package::async_check_error()
+{
+    mutex_lock(async->lock);
+    const string error = async->error;
+    mutex_unlock(async->lock);
+    if (!error.empty())
+        fail("%s", error.c_str());
+}
+
+static void _deflate_chunk(const vector<unsigned char> &in,
+                           vector<unsigned char> &out)
+{
+#ifdef USE_ZLIB
+    z_stream zs;
+    zs.zalloc = 0;
+    zs.zfree  = 0;
+    zs.opaque = Z_NULL;
+    if (deflateInit(&zs, Z_DEFAULT_COMPRESSION))
+        fail("save file compression failed during init: %s", zs.msg);
+
+    out.resize(deflateBound(&zs, in.size()));
+    zs.next_in   = (Bytef*)in.data();
+    zs.avail_in  = in.size();
+    zs.next_out  = out.data();
+    zs.avail_out = out.size();
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END)
+        fail("save file compression failed: %s", zs.msg);
+    out.resize(zs.total_out);
+    if (deflateEnd(&zs) != Z_OK)
+        fail("save file compression failed during clean-up: %s", zs.msg);
+#else
+    out = in;
+#endif
+}
+
+void *package::async_main(void *pkg)
+{
+    static_cast<package*>(pkg)->async_loop();
+    return nullptr;
+}
+
+void package::async_loop()
+{
+    mutex_lock(async->lock);
+    while (true)
+    {
+        while (async->queue.empty() && !async->quit)
+            cond_wait(async->wake, async->lock);
+        if (async->queue.empty())
+            break;
+
+        async_job job = move(async->queue.front());
+        async->queue.pop_front();
+        // Once something has failed, later writes and commits could only
+        // make things worse; drop them and let the game report the error.
+        const bool skip = !async->error.empty();
+        async->busy = true;
+        mutex_unlock(async->lock);
+
+        try
+        {
+            if (skip)
+                ;
+            else if (job.commit)
+                commit_now(); // takes the lock itself, around the fsyncs
+            else
+            {
+                // The slow part, compression, runs without the lock.
+                vector<unsigned char> compressed;
+                _deflate_chunk(job.data, compressed);
+
+                PACKAGE_GUARD(this);
+                if (!aborted)
+                {
+                    chunk_writer out(this, job.name, true);
+                    out.write(compressed.data(), compressed.size());
+                }
+            }
+        }
+        catch (exception &e)
+        {
+            mutex_lock(async->lock);
+            if (async->error.empty())
+                async->error = e.what();
+            mutex_unlock(async->lock);
+        }
+
+        mutex_lock(async->lock);
+        if (!job.commit)
+        {
+            auto pend = async->pending.find(job.name);
+            if (pend != async->pending.end() && !--pend->second)
+                async->pending.erase(pend);
+        }
+        async->busy = false;
+        cond_wake(async->idle);
+    }
+    mutex_unlock(async->lock);
+}
+#endif
+
+chunk_writer::chunk_writer(package *parent, const string &_name,
+                           bool _precompressed)
+    : first_block(0), cur_block(0), block_len(0),
+      precompressed(_precompressed)
 {
     ASSERT(parent);
     ASSERT(!parent->aborted);
@@ -679,10 +1046,16 @@ chunk_writer::chunk_writer(package *parent, const string &_name)
 
     dprintf("chunk_writer(%s): starting\n", _name.c_str());
     pkg = parent;
+    PACKAGE_GUARD(pkg);
     pkg->n_users++;
     name = _name;
 
 #ifdef USE_ZLIB
+    // Data that's already a zlib stream goes out as it is.
+    z_buffer = nullptr;
+    if (precompressed)
+        return;
+
     zs.data_type = Z_BINARY;
     zs.zalloc    = 0;
     zs.zfree     = 0;
@@ -699,33 +1072,40 @@ chunk_writer::~chunk_writer()
 {
     dprintf("chunk_writer(%s): closing\n", name.c_str());
 
+    PACKAGE_GUARD(pkg);
     ASSERT(pkg->n_users > 0);
     pkg->n_users--;
     if (pkg->aborted)
     {
 #ifdef USE_ZLIB
         // ignore errors, they're not relevant anymore
-        deflateEnd(&zs);
-        free(z_buffer);
+        if (!precompressed)
+        {
+            deflateEnd(&zs);
+            free(z_buffer);
+        }
 #endif
         return;
     }
 
 #ifdef USE_ZLIB
-    zs.avail_in = 0;
-    int res;
-    do
+    if (!precompressed)
     {
-        res = deflate(&zs, Z_FINISH);
-        if (res != Z_STREAM_END && res != Z_OK && res != Z_BUF_ERROR)
-            fail("save file compression failed: %s", zs.msg);
-        raw_write(z_buffer, zs.next_out - z_buffer);
-        zs.next_out = z_buffer;
-        zs.avail_out = ZB_SIZE;
-    } while (res != Z_STREAM_END);
-    if (deflateEnd(&zs) != Z_OK)
-        fail("save file compression failed during clean-up: %s", zs.msg);
-    free(z_buffer);
+        zs.avail_in = 0;
+        int res;
+        do
+        {
+            res = deflate(&zs, Z_FINISH);
+            if (res != Z_STREAM_END && res != Z_OK && res != Z_BUF_ERROR)
+                fail("save file compression failed: %s", zs.msg);
+            raw_write(z_buffer, zs.next_out - z_buffer);
+            zs.next_out = z_buffer;
+            zs.avail_out = ZB_SIZE;
+        } while (res != Z_STREAM_END);
+        if (deflateEnd(&zs) != Z_OK)
+            fail("save file compression failed during clean-up: %s", zs.msg);
+        free(z_buffer);
+    }
 #endif
     if (cur_block)
         finish_block(0);
@@ -734,6 +1114,7 @@ chunk_writer::~chunk_writer()
 
 void chunk_writer::raw_write(const void *data, plen_t len)
 {
+    PACKAGE_GUARD(pkg);
     while (len > 0)
     {
         plen_t space = pkg->extend_block(cur_block, block_len, len);
@@ -777,6 +1158,12 @@ void chunk_writer::write(const void *data, plen_t len)
     ASSERT(!pkg->aborted);
 
 #ifdef USE_ZLIB
+    if (precompressed)
+    {
+        raw_write(data, len);
+        return;
+    }
+
     zs.next_in  = (Bytef*)data;
     zs.avail_in = len;
     while (zs.avail_in)
@@ -796,8 +1183,14 @@ void chunk_writer::write(const void *data, plen_t len)
 #endif
 }
 
+bool chunk_writer::aborted() const
+{
+    return pkg->aborted;
+}
+
 void chunk_reader::init(plen_t start)
 {
+    PACKAGE_GUARD(pkg);
     ASSERT(!pkg->aborted);
     pkg->n_users++;
     pkg->reader_count[start]++;
@@ -834,7 +1227,8 @@ chunk_reader::chunk_reader(package *parent, const string &_name)
         corrupted("save file corrupted -- chunk \"%s\" missing", _name.c_str());
     dprintf("chunk_reader(%s): starting\n", _name.c_str());
     pkg = parent;
-    init(parent->directory[_name]);
+    PACKAGE_GUARD(pkg);
+    init(pkg->directory[_name]);
 }
 
 chunk_reader::~chunk_reader()
@@ -845,6 +1239,7 @@ chunk_reader::~chunk_reader()
     if (inflateEnd(&zs) != Z_OK)
         fail("save file decompression failed during clean-up: %s", zs.msg);
 #endif
+    PACKAGE_GUARD(pkg);
     ASSERT(pkg->reader_count[first_block] > 0);
     if (!--pkg->reader_count[first_block])
         pkg->reader_count.erase(first_block);
@@ -854,6 +1249,7 @@ chunk_reader::~chunk_reader()
 
 plen_t chunk_reader::raw_read(void *data, plen_t len)
 {
+    PACKAGE_GUARD(pkg);
     void *buf = data;
     while (len)
     {
@@ -13,11 +13,19 @@
 #define DO_FSYNC
 #endif
 
+// Compress, write and commit the game's save on a background thread.
+#if !defined(TARGET_OS_WINDOWS) && !defined(__ANDROID__)
+#define ASYNC_SAVE
+#endif
+
 #define MAX_CHUNK_NAME_LENGTH 255
 
 typedef uint32_t plen_t;
 
 class package;
+#ifdef ASYNC_SAVE
+struct package_async;
+#endif
 
 class chunk_writer
 {
@@ -27,6 +35,7 @@ private:
     plen_t first_block;
     plen_t cur_block;
     plen_t block_len;
+    bool precompressed;
 #ifdef USE_ZLIB
     z_stream zs;
     Bytef *z_buffer;
@@ -34,9 +43,11 @@ private:
     void raw_write(const void *data, plen_t len);
     void finish_block(plen_t next);
 public:
-    chunk_writer(package *parent, const string &_name);
+    chunk_writer(package *parent, const string &_name,
+                 bool _precompressed = false);
     ~chunk_writer();
     void write(const void *data, plen_t len);
+    bool aborted() const;
     friend class package;
 };
 
@@ -77,6 +88,11 @@ public:
     void abort();
     void unlink();
 
+    void enable_async();
+    bool is_async() const;
+    void write_async(const string &name, vector<unsigned char> &data);
+    void flush();
+
     // statistics
     plen_t get_slack();
     plen_t get_size() const { return file_len; };
@@ -99,6 +115,14 @@ private:
     map<plen_t, pair<plen_t, plen_t> > block_map;
     set<plen_t> new_chunks;
     map<plen_t, uint32_t> reader_count;
+#ifdef ASYNC_SAVE
+    package_async *async;
+    static void *async_main(void *pkg);
+    void async_loop();
+    void async_check_error();
+#endif
+    void wait_for_chunk(const string &name);
+    void commit_now();
     plen_t extend_block(plen_t at, plen_t size, plen_t by);
     plen_t alloc_block(plen_t &size);
     void finish_chunk(const string &name, plen_t at);
@@ -41,6 +41,7 @@
 #include "hints.h"
 #include "hiscores.h"
 #include "invent.h"
+#include "item-name.h"
 #include "item-prop.h"
 #include "items.h"
 #include "item-use.h"
@@ -5338,6 +5339,7 @@ player::player()
     dactions.clear();
     level_stack.clear();
     type_ids.init(false);
+    invalidate_item_names();
 
     banished_by.clear();
     banished_power = 0;
@@ -0,0 +1,474 @@
+/**
+ * @file
+ * @brief Speculative generation of adjacent levels in forked helpers.
+ *
+ * When the player arrives on a level, the unvisited levels directly
+ * reachable from it (the next level of the branch and any branch entered
+ * from here) are built by forked copies of the game. Each helper writes the
+ * level, together with the global state the level generator changed, to a
+ * side package; once it has exited the game imports both into the save as
+ * "pregen:" chunks. When the player later takes the stairs, load_level()
+ * uses the parked copy instead of calling builder(), provided that nothing
+ * the generator reads has changed since the fork.
+**/
+
+#include "AppHdr.h"
+
+#include "pregen.h"
+
+#ifndef TARGET_OS_WINDOWS
+# include <csignal>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
+#include "act-iter.h"
+#include "art-enum.h"
+#include "branch.h"
+#include "cloud.h"
+#include "dgn-event.h"
+#include "dlua.h"
+#include "dungeon.h"
+#include "files.h"
+#include "items.h"
+#include "monster.h"
+#include "options.h"
+#include "player.h"
+#include "state.h"
+#include "stringutil.h"
+#include "syscalls.h"
+#include "tags.h"
+
+#define PREGEN_PREFIX "pregen:"
+#define PREGEN_STATE_SUFFIX ":state"
+
+struct pregen_job
+{
+    pid_t pid;
+    string path;
+};
+
+static map<level_id, pregen_job> _jobs;
+
+bool pregen_eligible(const level_id &lid)
+{
+#ifdef TARGET_OS_WINDOWS
+    return false;
+#else
+    return Options.pregen_levels
+           && crawl_state.game_standard_levelgen()
+           && lid.is_valid()
+           && is_connected_branch(lid.branch)
+           && lid.depth <= brdepth[lid.branch];
+#endif
+}
+
+/**
+ * The game's key for levels' private generation streams. It is derived
+ * from an existing seed instead of being a game seed of its own: drawing
+ * one more seed when the game starts would shift the gameplay stream, and
+ * with it every seeded game.
+ */
+uint64_t pregen_game_seed()
+{
+    return hash3(you.game_seeds[SEED_PASSIVE_MAP], 0x6c6576656c67656eULL,
+                 0); // "levelgen"
+}
+
+/**
+ * The key for a level's private generation stream. Combined with
+ * pregen_game_seed(), this makes a level's layout depend only on the game
+ * and the place, not on when or in which process it was built.
+ */
+uint64_t pregen_level_seed(const level_id &lid)
+{
+    return hash3(lid.branch, lid.depth, 0);
+}
+
+static string _level_chunk(const level_id &lid)
+{
+    return PREGEN_PREFIX + lid.describe();
+}
+
+static string _state_chunk(const level_id &lid)
+{
+    return _level_chunk(lid) + PREGEN_STATE_SUFFIX;
+}
+
+// The global (non-level) state that builder() both reads and writes.
+static void _marshall_levelgen_globals(writer &th)
+{
+    marshallUnsigned(th, you.uniq_map_tags.size());
+    for (const string &tag : you.uniq_map_tags)
+        marshallString(th, tag);
+    marshallUnsigned(th, you.uniq_map_names.size());
+    for (const string &name : you.uniq_map_names)
+        marshallString(th, name);
+
+    marshallShort(th, NUM_MONSTERS);
+    for (int i = 0; i < NUM_MONSTERS; ++i)
+        marshallBoolean(th, you.unique_creatures[i]);
+    marshallUByte(th, NUM_UNRANDARTS);
+    for (int i = 0; i < NUM_UNRANDARTS; ++i)
+        marshallByte(th, you.unique_items[i]);
+
+    if (!dlua.callfn("dgn_save_data", "u", &th))
+        mprf(MSGCH_ERROR, "Failed to save Lua data: %s", dlua.error.c_str());
+}
+
+static void _unmarshall_levelgen_globals(reader &th)
+{
+    you.uniq_map_tags.clear();
+    for (int i = unmarshallUnsigned(th); i > 0; --i)
+        you.uniq_map_tags.insert(unmarshallString(th));
+    you.uniq_map_names.clear();
+    for (int i = unmarshallUnsigned(th); i > 0; --i)
+        you.uniq_map_names.insert(unmarshallString(th));
+
+    const int nmons = unmarshallShort(th);
+    ASSERT(nmons == NUM_MONSTERS);
+    for (int i = 0; i < nmons; ++i)
+        you.unique_creatures.set(i, unmarshallBoolean(th));
+    const int nunrands = unmarshallUByte(th);
+    ASSERT(nunrands == NUM_UNRANDARTS);
+    for (int i = 0; i < nunrands; ++i)
+    {
+        you.unique_items[i] =
+            static_cast<unique_item_status_type>(unmarshallByte(th));
+    }
+
+    if (!dlua.callfn("dgn_load_data", "u", &th))
+    {
+        mprf(MSGCH_ERROR, "Failed to load Lua persist table: %s",
+             dlua.error.c_str());
+    }
+}
+
+/**
+ * A hash of everything outside the level that affects how it is built.
+ * Vaults also look at things like skills and the turn count, but only for
+ * flavour; those are deliberately left out so that a parked level survives
+ * the player going about their business.
+ */
+static uint32_t _levelgen_fingerprint()
+{
+    vector<unsigned char> buf;
+    writer th(&buf);
+    _marshall_levelgen_globals(th);
+    marshallUByte(th, you.species);
+    marshallUByte(th, you.religion);
+    marshallInt(th, you.zigs_completed);
+    for (int i = 0; i < NUM_RUNE_TYPES; ++i)
+        marshallBoolean(th, you.runes[i]);
+    return hash32(buf.data(), buf.size());
+}
+
+#ifndef TARGET_OS_WINDOWS
+static void _write_version(writer &th)
+{
+    marshallUByte(th, TAG_MAJOR_VERSION);
+    marshallUByte(th, TAG_MINOR_VERSION);
+}
+
+/**
+ * Body of a helper process: build lid in our copy of the game and write it
+ * to a fresh package at path. Never returns.
+ */
+NORETURN static void _pregen_child(const level_id &lid,
+                                   dungeon_feature_type stair_type,
+                                   const string &path, uint32_t fingerprint)
+{
+    crawl_state.background_levelgen = true;
+    // Stay out of the way of the game we were forked from.
+    if (nice(10) == -1)
+        dprf("pregen: couldn't lower priority");
+
+    try
+    {
+        const mid_t fork_mid = you.last_mid;
+        const int fork_gold = you.attribute[ATTR_GOLD_GENERATED];
+
+        delete_all_clouds();
+        dungeon_events.clear();
+        you.where_are_you = lid.branch;
+        you.depth = lid.depth;
+        you.position.reset();
+        if (!generate_new_level(stair_type))
+            _exit(1);
+        fix_item_coordinates();
+
+        const string tmp = path + ".tmp";
+        {
+            package pkg(tmp.c_str(), true, true);
+            {
+                writer outf(&pkg, lid.describe());
+                _write_version(outf);
+                tag_write(TAG_LEVEL, outf);
+            }
+            {
+                writer outf(&pkg, lid.describe() + PREGEN_STATE_SUFFIX);
+                _write_version(outf);
+                marshallInt(outf, fingerprint);
+                marshallInt(outf, fork_mid);
+                marshallInt(outf, you.last_mid);
+                marshallInt(outf,
+                            you.attribute[ATTR_GOLD_GENERATED] - fork_gold);
+                const vector<string> &vaults = you.vault_list[lid];
+                marshallUnsigned(outf, vaults.size());
+                for (const string &vault : vaults)
+                    marshallString(outf, vault);
+                _marshall_levelgen_globals(outf);
+            }
+            pkg.commit();
+        }
+        if (rename_u(tmp.c_str(), path.c_str()))
+            _exit(1);
+    }
+    catch (...)
+    {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+static void _discard_parked(const level_id &lid)
+{
+    you.save->delete_chunk(_level_chunk(lid));
+    you.save->delete_chunk(_state_chunk(lid));
+}
+
+/**
+ * Check whether lid has a parked copy that is still valid. On success, the
+ * reader is left just past the fingerprint.
+ */
+static bool _parked_copy_current(const level_id &lid, reader &st)
+{
+    int major, minor;
+    return pregen_eligible(lid)
+           && you.save->has_chunk(_level_chunk(lid))
+           && get_save_version(st, major, minor)
+           && major == TAG_MAJOR_VERSION && minor == TAG_MINOR_VERSION
+           && (uint32_t)unmarshallInt(st) == _levelgen_fingerprint();
+}
+
+static void _start_job(const level_id &lid, dungeon_feature_type stair_type)
+{
+    if (_jobs.count(lid) || is_existing_level(lid))
+        return;
+
+    if (you.save->has_chunk(_state_chunk(lid)))
+    {
+        bool current;
+        {
+            reader st(you.save, _state_chunk(lid));
+            current = _parked_copy_current(lid, st);
+        }
+        if (current)
+            return;
+        dprf("pregen: %s is stale, rebuilding", lid.describe().c_str());
+        _discard_parked(lid);
+    }
+
+    const string save = get_savedir_filename(you.your_name);
+    const string path = make_stringf("%s.pregen-%d-%d", save.c_str(),
+                                     lid.branch, lid.depth);
+    const uint32_t fingerprint = _levelgen_fingerprint();
+
+    // Don't fork in the middle of a background save.
+    you.save->flush();
+
+    const pid_t pid = fork();
+    if (pid == -1)
+    {
+        dprf("pregen: fork failed for %s", lid.describe().c_str());
+        return;
+    }
+    if (!pid)
+        _pregen_child(lid, stair_type, path, fingerprint);
+
+    dprf("pregen: building %s in %d", lid.describe().c_str(), (int)pid);
+    _jobs[lid] = { pid, path };
+}
+
+// Copy a finished helper's chunks into the save, under the pregen: names.
+static void _import_job(const level_id &lid, const pregen_job &job)
+{
+    try
+    {
+        package pkg(job.path.c_str(), false);
+        const string chunks[] = { lid.describe(),
+                                  lid.describe() + PREGEN_STATE_SUFFIX };
+        for (const string &name : chunks)
+        {
+            chunk_reader in(&pkg, name);
+            vector<char> data;
+            in.read_all(data);
+
+            chunk_writer *out = you.save->writer(PREGEN_PREFIX + name);
+            out->write(data.data(), data.size());
+            delete out;
+        }
+    }
+    catch (exception &e)
+    {
+        dprf("pregen: discarding %s: %s", lid.describe().c_str(), e.what());
+        _discard_parked(lid);
+    }
+    unlink_u(job.path.c_str());
+}
+
+/**
+ * Reap helpers. If block is set, wait for the helper building only_lid (if
+ * any); otherwise just collect those that have already finished.
+ */
+static void _collect_jobs(bool block = false,
+                          const level_id &only_lid = level_id())
+{
+    for (auto it = _jobs.begin(); it != _jobs.end();)
+    {
+        const bool wait = block && it->first == only_lid;
+        int status;
+        const pid_t res = waitpid(it->second.pid, &status, wait ? 0 : WNOHANG);
+        if (res == 0)
+        {
+            ++it;
+            continue;
+        }
+
+        if (res == it->second.pid && WIFEXITED(status)
+            && WEXITSTATUS(status) == 0)
+        {
+            _import_job(it->first, it->second);
+        }
+        else
+            unlink_u(it->second.path.c_str());
+        it = _jobs.erase(it);
+    }
+}
+#endif
+
+/**
+ * Start building the unvisited levels adjacent to the current one, after
+ * collecting any helpers that have finished since the last call.
+ */
+void pregen_schedule_adjacent()
+{
+#ifndef TARGET_OS_WINDOWS
+    _collect_jobs();
+
+    const level_id here = level_id::current();
+    if (!pregen_eligible(here) || crawl_state.background_levelgen)
+        return;
+
+    const level_id next(here.branch, here.depth + 1);
+    if (pregen_eligible(next))
+        _start_job(next, DNGN_STONE_STAIRS_UP_I);
+
+    for (branch_iterator it; it; ++it)
+    {
+        const level_id entry(it->id, 1);
+        if (brentry[it->id] == here && pregen_eligible(entry))
+            _start_job(entry, it->exit_stairs);
+    }
+#endif
+}
+
+/**
+ * Make lid the current level from its parked copy, if there is a usable one.
+ *
+ * @return whether the level was restored. If not, the parked copy (if any)
+ *         is discarded and the caller should build the level as usual.
+ */
+bool pregen_restore_level(const level_id &lid)
+{
+#ifdef TARGET_OS_WINDOWS
+    return false;
+#else
+    if (_jobs.count(lid))
+        _collect_jobs(true, lid);
+
+    const string level_chunk = _level_chunk(lid);
+    const string state_chunk = _state_chunk(lid);
+    if (!you.save->has_chunk(state_chunk))
+        return false;
+
+    bool restored = false;
+    {
+        reader st(you.save, state_chunk);
+        if (_parked_copy_current(lid, st))
+        {
+            const mid_t fork_mid = unmarshallInt(st);
+            const mid_t last_mid = unmarshallInt(st);
+            const int gold = unmarshallInt(st);
+
+            reader inf(you.save, level_chunk);
+            int major, minor;
+            get_save_version(inf, major, minor);
+            crawl_state.minor_version = minor;
+            tag_read(inf, TAG_LEVEL);
+            inf.fail_if_not_eof(level_chunk);
+
+            vector<string> &vaults = you.vault_list[lid];
+            vaults.clear();
+            for (int i = unmarshallUnsigned(st); i > 0; --i)
+                vaults.push_back(unmarshallString(st));
+            _unmarshall_levelgen_globals(st);
+            st.fail_if_not_eof(state_chunk);
+            you.attribute[ATTR_GOLD_GENERATED] += gold;
+
+            // The helper numbered its monsters from fork_mid; move them past
+            // anything the game has created since.
+            if (you.last_mid != fork_mid)
+            {
+                const mid_t shift = you.last_mid - fork_mid;
+                auto fix = [=](mid_t m)
+                {
+                    return m > fork_mid && m <= last_mid ? m + shift : m;
+                };
+                env.mid_cache.clear();
+                for (monster_iterator mi; mi; ++mi)
+                {
+                    mi->mid = fix(mi->mid);
+                    mi->summoner = fix(mi->summoner);
+                    for (const char *key : { "band_leader", "summon_id" })
+                    {
+                        if (!mi->props.exists(key))
+                            continue;
+                        int &ref = mi->props[key].get_int();
+                        ref = fix(ref);
+                    }
+                    env.mid_cache[mi->mid] = mi->mindex();
+                }
+                you.last_mid = last_mid + shift;
+            }
+            else
+                you.last_mid = last_mid;
+
+            restored = true;
+        }
+    }
+
+    dprf("pregen: %s %s", restored ? "using" : "discarding",
+         lid.describe().c_str());
+    _discard_parked(lid);
+    return restored;
+#endif
+}
+
+/// Kill any running helpers and remove their output.
+void pregen_cancel_all()
+{
+#ifndef TARGET_OS_WINDOWS
+    if (crawl_state.background_levelgen)
+        return;
+
+    for (const auto &job : _jobs)
+    {
+        kill(job.second.pid, SIGKILL);
+        waitpid(job.second.pid, nullptr, 0);
+        unlink_u(job.second.path.c_str());
+        unlink_u((job.second.path + ".tmp").c_str());
+    }
+    _jobs.clear();
+#endif
+}
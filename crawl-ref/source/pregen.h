@@ -0,0 +1,16 @@
+/**
+ * @file
+ * @brief Speculative generation of adjacent levels in forked helpers.
+**/
+
+#pragma once
+
+class level_id;
+
+bool pregen_eligible(const level_id &lid);
+uint64_t pregen_game_seed();
+uint64_t pregen_level_seed(const level_id &lid);
+
+void pregen_schedule_adjacent();
+bool pregen_restore_level(const level_id &lid);
+void pregen_cancel_all();
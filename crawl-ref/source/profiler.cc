@@ -0,0 +1,219 @@
+/**
+ * @file
+ * @brief Scoped timing zones for finding slow turns.
+ *
+ * Every zone keeps a call count, its total time, and a histogram of how
+ * much time it took per turn (a turn being the stretch between two calls
+ * to world_reacts()). Zones that aren't marked hot also log each entry
+ * into a fixed-size ring buffer. That buffer is written out in Chrome's
+ * trace event format, so the most recent turns can be viewed in
+ * chrome://tracing or Perfetto.
+**/
+
+#include "AppHdr.h"
+
+#ifdef PROFILE_ZONES
+
+#include "profiler.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include "message.h"
+#include "player.h"
+#include "syscalls.h"
+
+// Per-turn histogram buckets: bucket i counts turns in which the zone took
+// [2^(i-1), 2^i) microseconds, bucket 0 anything under a microsecond.
+#define PROF_HIST_BUCKETS 25
+#define MAX_PROF_ZONES 64
+// Number of trace events kept; older ones are overwritten.
+#define PROF_TRACE_EVENTS (1 << 17)
+
+struct prof_zone_stats
+{
+    const char *name;
+    bool hot;
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t turn_ns;
+    uint64_t worst_turn_ns;
+    uint32_t turn_hist[PROF_HIST_BUCKETS];
+};
+
+struct prof_event
+{
+    uint64_t start_ns;
+    uint64_t dur_ns;
+    int turn;
+    uint16_t zone;
+    uint16_t depth;
+};
+
+static prof_zone_stats zones[MAX_PROF_ZONES];
+static int num_zones = 0;
+
+static vector<prof_event> trace;
+static size_t trace_next = 0;
+static bool trace_wrapped = false;
+static int zone_depth = 0;
+
+static const chrono::steady_clock::time_point prof_epoch
+    = chrono::steady_clock::now();
+
+static uint64_t _prof_now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now() - prof_epoch).count();
+}
+
+int prof_register_zone(const char *name, bool hot)
+{
+    ASSERT(num_zones < MAX_PROF_ZONES);
+    zones[num_zones].name = name;
+    zones[num_zones].hot  = hot;
+    return num_zones++;
+}
+
+prof_zone::prof_zone(int z) : zone(z), start(_prof_now())
+{
+    ++zone_depth;
+}
+
+prof_zone::~prof_zone()
+{
+    const uint64_t dur = _prof_now() - start;
+    --zone_depth;
+
+    prof_zone_stats &stats = zones[zone];
+    stats.calls++;
+    stats.total_ns += dur;
+    stats.turn_ns  += dur;
+
+    if (stats.hot)
+        return;
+
+    if (trace.empty())
+        trace.resize(PROF_TRACE_EVENTS);
+
+    prof_event &ev = trace[trace_next];
+    ev.start_ns = start;
+    ev.dur_ns   = dur;
+    ev.turn     = you.num_turns;
+    ev.zone     = zone;
+    ev.depth    = zone_depth;
+
+    if (++trace_next == trace.size())
+    {
+        trace_next = 0;
+        trace_wrapped = true;
+    }
+}
+
+static int _hist_bucket(uint64_t ns)
+{
+    int bucket = 0;
+    for (uint64_t us = ns / 1000; us && bucket < PROF_HIST_BUCKETS - 1;
+         us >>= 1)
+    {
+        bucket++;
+    }
+    return bucket;
+}
+
+void prof_new_turn()
+{
+    for (int i = 0; i < num_zones; ++i)
+    {
+        prof_zone_stats &stats = zones[i];
+        if (!stats.turn_ns)
+            continue;
+
+        stats.turn_hist[_hist_bucket(stats.turn_ns)]++;
+        stats.worst_turn_ns = max(stats.worst_turn_ns, stats.turn_ns);
+        stats.turn_ns = 0;
+    }
+}
+
+static void _write_trace(FILE *f)
+{
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    const size_t count = trace_wrapped ? trace.size() : trace_next;
+    const size_t first = trace_wrapped ? trace_next : 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const prof_event &ev = trace[(first + i) % trace.size()];
+        fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"crawl\",\"ph\":\"X\","
+                   "\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+                   "\"args\":{\"turn\":%d,\"depth\":%d}}",
+                i ? "," : "", zones[ev.zone].name,
+                ev.start_ns / 1000.0, ev.dur_ns / 1000.0,
+                ev.turn, ev.depth);
+    }
+
+    fprintf(f, "\n]}\n");
+}
+
+static void _write_histograms(FILE *f)
+{
+    fprintf(f, "%-28s %10s %12s %12s\n",
+            "zone", "calls", "total ms", "worst turn");
+    for (int i = 0; i < num_zones; ++i)
+    {
+        const prof_zone_stats &stats = zones[i];
+        if (!stats.calls)
+            continue;
+
+        fprintf(f, "%-28s %10" PRIu64 " %12.3f %12.3f\n",
+                stats.name, stats.calls, stats.total_ns / 1e6,
+                stats.worst_turn_ns / 1e6);
+
+        fprintf(f, "    per-turn:");
+        for (int b = 0; b < PROF_HIST_BUCKETS; ++b)
+        {
+            if (!stats.turn_hist[b])
+                continue;
+            if (b)
+                fprintf(f, " <%dus:%u", 1 << b, stats.turn_hist[b]);
+            else
+                fprintf(f, " <1us:%u", stats.turn_hist[b]);
+        }
+        fprintf(f, "\n");
+    }
+}
+
+/**
+ * Write the trace to a file, and the per-turn histograms to the same name
+ * with ".hist" appended.
+ *
+ * @return whether both files could be written.
+ */
+bool prof_dump(const string &trace_file)
+{
+    FILE *f = fopen_u(trace_file.c_str(), "w");
+    if (!f)
+        return false;
+    _write_trace(f);
+    fclose(f);
+
+    f = fopen_u((trace_file + ".hist").c_str(), "w");
+    if (!f)
+        return false;
+    _write_histograms(f);
+    fclose(f);
+    return true;
+}
+
+#ifdef WIZARD
+void wizard_dump_profile()
+{
+    const string file = "profile.json";
+    if (prof_dump(file))
+        mprf("Wrote %s and %s.hist.", file.c_str(), file.c_str());
+    else
+        mprf(MSGCH_ERROR, "Couldn't write %s.", file.c_str());
+}
+#endif
+
+#endif // PROFILE_ZONES
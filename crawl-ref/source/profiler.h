@@ -0,0 +1,49 @@
+/**
+ * @file
+ * @brief Scoped timing zones for finding slow turns.
+ *
+ * Only compiled in when PROFILE_ZONES is defined (make PROFILE_ZONES=y);
+ * otherwise the zone macros expand to nothing.
+**/
+
+#pragma once
+
+#ifdef PROFILE_ZONES
+
+int prof_register_zone(const char *name, bool hot);
+
+// Times the enclosing scope against a registered zone.
+class prof_zone
+{
+public:
+    explicit prof_zone(int zone);
+    ~prof_zone();
+
+private:
+    int zone;
+    uint64_t start;
+};
+
+void prof_new_turn();
+bool prof_dump(const string &trace_file);
+void wizard_dump_profile();
+
+#define PROF_ZONE_CAT_(a, b) a##b
+#define PROF_ZONE_CAT(a, b) PROF_ZONE_CAT_(a, b)
+#define PROF_ZONE_(name, hot)                                           \
+    static const int PROF_ZONE_CAT(prof_id_, __LINE__)                  \
+        = prof_register_zone(name, hot);                                \
+    prof_zone PROF_ZONE_CAT(prof_scope_, __LINE__)(                     \
+        PROF_ZONE_CAT(prof_id_, __LINE__))
+
+// A zone that shows up both in the histograms and the trace.
+#define PROF_ZONE(name) PROF_ZONE_(name, false)
+// A zone entered so often that it is only counted, never traced.
+#define PROF_HOT_ZONE(name) PROF_ZONE_(name, true)
+
+#else
+
+#define PROF_ZONE(name) do { } while (0)
+#define PROF_HOT_ZONE(name) do { } while (0)
+
+#endif
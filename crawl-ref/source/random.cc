@@ -50,6 +50,29 @@ void seed_rng()
     _seed_rng(seed_key, ARRAYSZ(seed_key));
 }
 
+vector<PcgRNG> get_rng_states()
+{
+    return vector<PcgRNG>(rngs.begin(), rngs.end());
+}
+
+void set_rng_states(const vector<PcgRNG> &states)
+{
+    ASSERT(states.size() == rngs.size());
+    copy(states.begin(), states.end(), rngs.begin());
+}
+
+rng_subgenerator::rng_subgenerator(uint64_t seed_a, uint64_t seed_b)
+    : saved(rngs[RNG_GAMEPLAY])
+{
+    uint64_t key[2] = { seed_a, seed_b };
+    rngs[RNG_GAMEPLAY] = PcgRNG(key, ARRAYSZ(key));
+}
+
+rng_subgenerator::~rng_subgenerator()
+{
+    rngs[RNG_GAMEPLAY] = saved;
+}
+
 // [low, high]
 int random_range(int low, int high)
 {
@@ -6,12 +6,17 @@
 #include <vector>
 
 #include "hash.h"
+#include "pcg.h"
 #include "rng-type.h"
 
 void seed_rng();
 void seed_rng(uint32_t seed);
 void seed_rng(uint64_t[], int);
 
+// Every generator's state, to put back later with set_rng_states().
+vector<PcgRNG> get_rng_states();
+void set_rng_states(const vector<PcgRNG> &states);
+
 uint32_t get_uint32(int generator = RNG_GAMEPLAY);
 uint64_t get_uint64(int generator = RNG_GAMEPLAY);
 bool coinflip();
@@ -39,6 +44,22 @@ bool decimal_chance(double percent);
 
 int ui_random(int max);
 
+/**
+ * Replace the gameplay RNG with one seeded from a fixed key for the lifetime
+ * of this object, restoring the previous state afterwards. Used to make
+ * things like level generation independent of how much randomness was
+ * consumed beforehand.
+ */
+class rng_subgenerator
+{
+public:
+    rng_subgenerator(uint64_t seed_a, uint64_t seed_b);
+    ~rng_subgenerator();
+
+private:
+    PcgRNG saved;
+};
+
 /** Chooses one of the objects passed in at random (by value).
  *  @return One of the arguments.
  *
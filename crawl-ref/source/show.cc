@@ -230,7 +230,10 @@ void update_item_at(const coord_def &gp, bool detected, bool wizard)
     if (!in_bounds(gp))
         return;
 
-    item_def eitem;
+    // Refer to the item rather than copying it: get_item_info() makes the
+    // one copy that's needed.
+    const item_def *eitem;
+    vector<item_def> stash;
     bool more_items = false;
 
     if (you.see_cell(gp) || wizard)
@@ -238,12 +241,12 @@ void update_item_at(const coord_def &gp, bool detected, bool wizard)
         const int item_grid = wizard ? igrd(gp) : you.visible_igrd(gp);
         if (item_grid == NON_ITEM)
             return;
-        eitem = mitm[item_grid];
+        eitem = &mitm[item_grid];
 
         // monster(mimic)-owned items have link = NON_ITEM+1+midx
-        if (eitem.link > NON_ITEM)
+        if (eitem->link > NON_ITEM)
             more_items = true;
-        else if (eitem.link < NON_ITEM && !crawl_state.game_is_arena())
+        else if (eitem->link < NON_ITEM && !crawl_state.game_is_arena())
             more_items = true;
 
         if (wizard)
@@ -254,15 +257,15 @@ void update_item_at(const coord_def &gp, bool detected, bool wizard)
         if (detected)
             StashTrack.add_stash(gp);
 
-        const vector<item_def> stash = item_list_in_stash(gp);
+        stash = item_list_in_stash(gp);
         if (stash.empty())
             return;
 
-        eitem = stash[0];
+        eitem = &stash[0];
         if (!detected && stash.size() > 1)
             more_items = true;
     }
-    env.map_knowledge(gp).set_item(get_item_info(eitem), more_items);
+    env.map_knowledge(gp).set_item(get_item_info(*eitem), more_items);
 }
 
 static void _update_cloud(cloud_struct& cloud)
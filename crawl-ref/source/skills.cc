@@ -48,8 +48,13 @@
 #define MAX_SPENDING_LIMIT       265
 
 static int _train(skill_type exsk, int &max_exp, bool simu = false);
+static int _train_steps(skill_type exsk, int &max_exp, int cost, bool simu);
 static void _train_skills(int exp, const int cost, const bool simu);
 
+// Train one _train() at a time instead of with _train_steps(), to check
+// the latter against.
+static bool train_stepwise = false;
+
 // Basic goals for titles:
 // The higher titles must come last.
 // Referring to the skill itself is fine ("Transmuter") but not impressive.
@@ -937,7 +942,9 @@ static void _train_skills(int exp, const int cost, const bool simu)
             while (sk_exp[sk] >= cost && you.training[sk])
             {
                 exp -= sk_exp[sk];
-                gain += _train(sk, sk_exp[sk], simu);
+                gain += train_stepwise ? _train(sk, sk_exp[sk], simu)
+                                       : _train_steps(sk, sk_exp[sk], cost,
+                                                      simu);
                 exp += sk_exp[sk];
                 ASSERT(exp >= 0);
                 if (_level_up_check(sk, simu))
@@ -1098,6 +1105,118 @@ static int _train(skill_type exsk, int &max_exp, bool simu)
     return skill_inc;
 }
 
+// Total unread skill points in the manuals for a skill.
+static int _manual_charges(skill_type sk)
+{
+    int charges = 0;
+    for (const item_def &item : you.inv)
+    {
+        if (item.base_type == OBJ_BOOKS && item.sub_type == BOOK_MANUAL
+            && item.skill == sk)
+        {
+            charges += item.skill_points;
+        }
+    }
+    return charges;
+}
+
+/**
+ * Do in one go what calling _train() while max_exp lasts would, stopping
+ * (as _train_skills() does) once the skill reaches level 27. That's
+ * exact as long as every step costs the full @p cost, which holds because
+ * _train_skills() is never given enough XP to cross more than one skill
+ * cost level, and only with its very last step.
+ *
+ * @return the skill points gained.
+ */
+static int _train_steps(skill_type exsk, int &max_exp, int cost, bool simu)
+{
+    ASSERT(cost == calc_skill_cost(you.skill_cost_level));
+    ASSERT(cost <= MAX_SPENDING_LIMIT);
+
+    int steps = max_exp / cost;
+    if (steps <= 0)
+        return 0;
+
+    // Each step gains 10 points, and up to 10 more from manuals. The
+    // first step after which the skill is at 27 is the last one.
+    const int charges = _manual_charges(exsk);
+    const int need = (int) skill_exp_needed(MAX_SKILL_LEVEL, exsk)
+                     - (int) you.skill_points[exsk];
+    if (need <= 0)
+        steps = 1;
+    else
+    {
+        int to_max = (need + 19) / 20;
+        if (to_max * 10 > charges)
+            to_max = max(to_max, (need - charges + 9) / 10);
+        steps = min(steps, to_max);
+    }
+
+    const int base = steps * 10;
+    int skill_inc = base;
+    int bonus_left = min(base, charges);
+    int slot;
+    while (bonus_left > 0 && (slot = manual_slot_for_skill(exsk)) != -1)
+    {
+        item_def& manual(you.inv[slot]);
+        const int bonus = min<int>(bonus_left, manual.skill_points);
+        skill_inc += bonus;
+        bonus_left -= bonus;
+        manual.skill_points -= bonus;
+        if (!manual.skill_points && !simu)
+            finish_manual(slot);
+    }
+
+    const int spent = steps * cost;
+    const skill_type old_best_skill = best_skill(SK_FIRST_SKILL, SK_LAST_SKILL);
+    you.skill_points[exsk] += skill_inc;
+    you.exp_available -= spent;
+    you.total_experience += spent;
+    max_exp -= spent;
+
+    if (!simu)
+        redraw_skill(exsk, old_best_skill);
+
+    check_skill_cost_change();
+    ASSERT(you.exp_available >= 0);
+    ASSERT(max_exp >= 0);
+    you.redraw_experience = true;
+
+    return skill_inc;
+}
+
+/**
+ * The skill points each skill would have after training with the given
+ * amount of experience, at the current training percentages. Nothing
+ * about the player changes, random choices included: the projection uses
+ * its own random numbers, seeded from the experience involved, so the
+ * same question always gets the same answer.
+ *
+ * @param exp      the experience to spend, instead of you.exp_available.
+ * @param stepwise whether to train one _train() step at a time, as
+ *                 training used to; only for checking the quick way.
+ */
+FixedVector<unsigned int, NUM_SKILLS> project_training(int exp,
+                                                       bool stepwise)
+{
+    skill_state saved;
+    saved.save();
+
+    you.exp_available = max(exp, 0);
+    {
+        unwind_bool step(train_stepwise, stepwise);
+        rng_subgenerator subgen(exp, you.total_experience);
+        train_skills(true);
+    }
+
+    const FixedVector<unsigned int, NUM_SKILLS> points = you.skill_points;
+    saved.restore_levels();
+    // train_skills() left the training set up for the projected levels.
+    reset_training();
+    return points;
+}
+
 void set_skill_level(skill_type skill, double amount)
 {
     double level;
@@ -58,6 +58,8 @@ bool is_magic_skill(skill_type sk);
 
 void exercise(skill_type exsk, int deg);
 void train_skills(bool simu = false);
+FixedVector<unsigned int, NUM_SKILLS> project_training(int exp,
+                                                       bool stepwise = false);
 bool skill_trained(int i);
 static inline bool skill_trained(skill_type sk) { return skill_trained((int) sk); }
 void redraw_skill(skill_type exsk, skill_type old_best_skill = SK_NONE);
@@ -9,6 +9,7 @@
 
 #include "abyss.h"
 #include "arena.h"
+#include "bench.h"
 #include "branch.h"
 #include "command.h"
 #include "coordit.h"
@@ -28,6 +29,7 @@
 #include "item-name.h"
 #include "item-prop.h"
 #include "items.h"
+#include "keylog.h"
 #include "libutil.h"
 #include "macro.h"
 #include "maps.h"
@@ -154,6 +156,7 @@ static void _initialize()
     }
 #endif
 
+    keylog_start();
     if (Options.seed)
         seed_rng(Options.seed);
 
@@ -172,6 +175,12 @@ static void _initialize()
     }
 #endif
 
+    if (crawl_state.bench)
+    {
+        release_cli_signals();
+        run_benchmarks();
+    }
+
     if (!crawl_state.test_list)
     {
         if (!crawl_state.io_inited)
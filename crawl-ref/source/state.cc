@@ -32,8 +32,11 @@ game_state::game_state()
       need_save(false), saving_game(false), updating_scores(false),
       seen_hups(0), map_stat_gen(false), obj_stat_gen(false),
       type(GAME_TYPE_NORMAL), last_type(GAME_TYPE_UNSPECIFIED),
-      arena_suspended(false), generating_level(false), dump_maps(false),
+      arena_suspended(false), generating_level(false),
+      background_levelgen(false), dump_maps(false),
       test(false), script(false), build_db(false), tests_selected(),
+      bench(false), benches_selected(), bench_baseline(),
+      bench_threshold(10), fsim_spec(), fsim_jobs(0), fsim_worker(false),
 #ifdef DGAMELAUNCH
       throttle(true),
 #else
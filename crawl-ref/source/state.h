@@ -60,6 +60,7 @@ struct game_state
     bool arena_suspended;   // Set if the arena has been temporarily
                             // suspended.
     bool generating_level;
+    bool background_levelgen; // Set in a forked level pregeneration helper.
 
     bool dump_maps;         // Dump map Lua to stderr on fresh parse.
     bool test;              // Set if we want to run self-tests and exit.
@@ -69,6 +70,15 @@ struct game_state
     vector<string> tests_selected; // Tests to be run.
     vector<string> script_args;    // Arguments to scripts.
 
+    bool bench;             // Set if we want to run benchmarks and exit.
+    vector<string> benches_selected; // Benchmark scenarios to be run.
+    string bench_baseline;  // Earlier -bench output to compare against.
+    int bench_threshold;    // Allowed slowdown against the baseline, in %.
+
+    string fsim_spec;       // Fight simulations to run (-fsim), then exit.
+    int fsim_jobs;          // Workers for -fsim; 0 for one per CPU.
+    bool fsim_worker;       // Set in a forked -fsim worker.
+
     bool throttle;
 
     bool show_more_prompt;  // Set to false to disable --more-- prompts.
@@ -101,7 +101,7 @@ extern abyss_state abyssal_state;
 
 reader::reader(const string &_read_filename, int minorVersion)
     : _filename(_read_filename), _chunk(0), _pbuf(nullptr), _read_offset(0),
-      _minorVersion(minorVersion), _safe_read(false)
+      _stage_pos(0), _minorVersion(minorVersion), _safe_read(false)
 {
     _file       = fopen_u(_filename.c_str(), "rb");
     opened_file = !!_file;
@@ -109,7 +109,7 @@ reader::reader(const string &_read_filename, int minorVersion)
 
 reader::reader(package *save, const string &chunkname, int minorVersion)
     : _file(0), _chunk(0), opened_file(false), _pbuf(0), _read_offset(0),
-     _minorVersion(minorVersion), _safe_read(false)
+      _stage_pos(0), _minorVersion(minorVersion), _safe_read(false)
 {
     ASSERT(save);
     _chunk = new chunk_reader(save, chunkname);
@@ -156,6 +156,19 @@ static NORETURN void _short_read(bool safe_read)
     die_noline("short read while reading save");
 }
 
+// Inflate the next block of a chunk into the stage, once the previous one
+// has been used up. Returns false at the end of the chunk.
+bool reader::fill_stage()
+{
+    ASSERT(_chunk);
+    ASSERT(_stage_pos == _stage.size());
+
+    _stage.resize(TAG_STAGE_SIZE);
+    _stage.resize(_chunk->read(_stage.data(), TAG_STAGE_SIZE));
+    _stage_pos = 0;
+    return !_stage.empty();
+}
+
 // Reads input in network byte order, from a file or buffer.
 unsigned char reader::readByte()
 {
@@ -168,10 +181,9 @@ unsigned char reader::readByte()
     }
     else if (_chunk)
     {
-        unsigned char buf;
-        if (_chunk->read(&buf, 1) != 1)
+        if (_stage_pos == _stage.size() && !fill_stage())
             _short_read(_safe_read);
-        return buf;
+        return _stage[_stage_pos++];
     }
     else
     {
@@ -195,8 +207,28 @@ void reader::read(void *data, size_t size)
     }
     else if (_chunk)
     {
-        if (_chunk->read(data, size) != size)
-            _short_read(_safe_read);
+        unsigned char *out = static_cast<unsigned char*>(data);
+        while (size)
+        {
+            if (_stage_pos == _stage.size())
+            {
+                // Big reads go straight through, skipping the stage.
+                if (size >= TAG_STAGE_SIZE)
+                {
+                    if (_chunk->read(out, size) != size)
+                        _short_read(_safe_read);
+                    return;
+                }
+                if (!fill_stage())
+                    _short_read(_safe_read);
+            }
+
+            const size_t len = min(size, _stage.size() - _stage_pos);
+            memcpy(out, &_stage[_stage_pos], len);
+            _stage_pos += len;
+            out += len;
+            size -= len;
+        }
     }
     else
     {
@@ -223,7 +255,7 @@ void reader::setMinorVersion(int minorVersion)
 void reader::fail_if_not_eof(const string &name)
 {
     char dummy;
-    if (_chunk ? _chunk->read(&dummy, 1) :
+    if (_chunk ? _stage_pos < _stage.size() || _chunk->read(&dummy, 1) :
         _file ? (fgetc(_file) != EOF) :
         _read_offset >= _pbuf->size())
     {
@@ -241,13 +273,57 @@ void writer::check_ok(bool ok)
     }
 }
 
+writer::writer(package *save, const string &chunkname)
+    : _filename(), _file(0), _chunk(0), _ignore_errors(false), _pbuf(0),
+      _async_save(0), failed(false)
+{
+    ASSERT(save);
+    if (save->is_async())
+    {
+        _async_save = save;
+        _chunkname = chunkname;
+        _pbuf = &_stage;
+    }
+    else
+    {
+        _chunk = save->writer(chunkname);
+        _stage.reserve(TAG_STAGE_SIZE);
+    }
+}
+
+writer::~writer()
+{
+    if (_async_save)
+        _async_save->write_async(_chunkname, _stage);
+    else if (_chunk)
+    {
+        // An aborted package discards anything not yet written anyway.
+        if (!_chunk->aborted())
+            flush_stage();
+        delete _chunk;
+    }
+}
+
+void writer::flush_stage()
+{
+    if (_stage.empty())
+        return;
+
+    _chunk->write(_stage.data(), _stage.size());
+    _stage.clear();
+}
+
 void writer::writeByte(unsigned char ch)
 {
     if (failed)
         return;
 
     if (_chunk)
-        _chunk->write(&ch, 1);
+    {
+        _stage.push_back(ch);
+        if (_stage.size() >= TAG_STAGE_SIZE)
+            flush_stage();
+    }
     else if (_file)
         check_ok(fputc(ch, _file) != EOF);
     else
@@ -260,7 +336,19 @@ void writer::write(const void *data, size_t size)
         return;
 
     if (_chunk)
-        _chunk->write(data, size);
+    {
+        if (_stage.size() + size < TAG_STAGE_SIZE)
+        {
+            const unsigned char* cdata
+                = static_cast<const unsigned char*>(data);
+            _stage.insert(_stage.end(), cdata, cdata + size);
+        }
+        else
+        {
+            flush_stage();
+            _chunk->write(data, size);
+        }
+    }
     else if (_file)
         check_ok(fwrite(data, 1, size, _file) == size);
     else
@@ -369,17 +457,21 @@ uint8_t unmarshallUByte(reader &th)
 void marshallShort(writer &th, short data)
 {
     CHECK_INITIALIZED(data);
-    const char b2 = (char)(data & 0x00FF);
-    const char b1 = (char)((data & 0xFF00) >> 8);
-    th.writeByte(b1);
-    th.writeByte(b2);
+    const char buf[2] =
+    {
+        (char)((data & 0xFF00) >> 8),
+        (char)(data & 0x00FF),
+    };
+    th.write(buf, sizeof(buf));
 }
 
 // Unmarshall 2 byte short in network order.
 int16_t unmarshallShort(reader &th)
 {
-    int16_t b1 = th.readByte();
-    int16_t b2 = th.readByte();
+    unsigned char buf[2];
+    th.read(buf, sizeof(buf));
+    int16_t b1 = buf[0];
+    int16_t b2 = buf[1];
     int16_t data = (b1 << 8) | (b2 & 0x00FF);
     return data;
 }
@@ -388,24 +480,25 @@ int16_t unmarshallShort(reader &th)
 void marshallInt(writer &th, int32_t data)
 {
     CHECK_INITIALIZED(data);
-    char b4 = (char) (data & 0x000000FF);
-    char b3 = (char)((data & 0x0000FF00) >> 8);
-    char b2 = (char)((data & 0x00FF0000) >> 16);
-    char b1 = (char)((data & 0xFF000000) >> 24);
-
-    th.writeByte(b1);
-    th.writeByte(b2);
-    th.writeByte(b3);
-    th.writeByte(b4);
+    const char buf[4] =
+    {
+        (char)((data & 0xFF000000) >> 24),
+        (char)((data & 0x00FF0000) >> 16),
+        (char)((data & 0x0000FF00) >> 8),
+        (char) (data & 0x000000FF),
+    };
+    th.write(buf, sizeof(buf));
 }
 
 // Unmarshall 4 byte signed int in network order.
 int32_t unmarshallInt(reader &th)
 {
-    int32_t b1 = th.readByte();
-    int32_t b2 = th.readByte();
-    int32_t b3 = th.readByte();
-    int32_t b4 = th.readByte();
+    unsigned char buf[4];
+    th.read(buf, sizeof(buf));
+    int32_t b1 = buf[0];
+    int32_t b2 = buf[1];
+    int32_t b3 = buf[2];
+    int32_t b4 = buf[3];
 
     int32_t data = (b1 << 24) | ((b2 & 0x000000FF) << 16);
     data |= ((b3 & 0x000000FF) << 8) | (b4 & 0x000000FF);
@@ -469,6 +562,8 @@ void marshallFixedBitVector(writer& th, const FixedBitVector<SIZE>& arr)
         if (arr[last_bit])
             break;
 
+    uint8_t bytes[SIZE / 7 + 1];
+    int len = 0;
     int i = 0;
     while (1)
     {
@@ -477,13 +572,14 @@ void marshallFixedBitVector(writer& th, const FixedBitVector<SIZE>& arr)
             if (i < SIZE && arr[i++])
                 byte |= 1 << j;
         if (i <= last_bit)
-            marshallUByte(th, byte);
+            bytes[len++] = byte;
         else
         {
-            marshallUByte(th, byte | 0x80);
+            bytes[len++] = byte | 0x80;
             break;
         }
     }
+    th.write(bytes, len);
 }
 
 template<int SIZE>
@@ -793,6 +889,57 @@ static void _run_length_decode(reader &th, unmarshall um, grid &g,
     }
 }
 
+// A fixed grid of integers in row order, each cell as sizeof(T) bytes in
+// network order. That's the same stream marshalling the cells one at a
+// time would produce, but it is built up and handed over in one piece.
+template <typename T, typename grid>
+static void _marshall_int_grid(writer &th, const grid &g, int width,
+                               int height)
+{
+    vector<unsigned char> buf(width * height * sizeof(T));
+    unsigned char *out = buf.data();
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            const uint32_t v = static_cast<T>(g[x][y]);
+            for (int b = sizeof(T) - 1; b >= 0; --b)
+                *out++ = (v >> (8 * b)) & 0xFF;
+        }
+    th.write(buf.data(), buf.size());
+}
+
+template <typename T, typename grid>
+static void _unmarshall_int_grid(reader &th, grid &g, int width, int height)
+{
+    vector<unsigned char> buf(width * height * sizeof(T));
+    th.read(buf.data(), buf.size());
+    const unsigned char *in = buf.data();
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            uint32_t v = 0;
+            for (size_t b = 0; b < sizeof(T); ++b)
+                v = (v << 8) | *in++;
+            g[x][y] = static_cast<T>(v);
+        }
+}
+
+// Marshall a whole grid's worth of fields through marshall_cells into
+// memory, then hand the result to th at once. The stream is the same as
+// marshalling straight into th; it just reaches the chunk in one write.
+template <typename F>
+static void _marshall_buffered(writer &th, size_t size_hint,
+                               F marshall_cells)
+{
+    vector<unsigned char> buf;
+    buf.reserve(size_hint);
+    {
+        writer mem(&buf);
+        marshall_cells(mem);
+    }
+    th.write(buf.data(), buf.size());
+}
+
 union float_marshall_kludge
 {
     // [ds] Does ANSI C guarantee that sizeof(float) == sizeof(long)?
@@ -3650,6 +3797,7 @@ static void tag_read_you_items(reader &th)
         old_type_id_props.read(th);
     }
 #endif
+    invalidate_item_names();
 
     EAT_CANARY;
 
@@ -4040,19 +4188,28 @@ static void tag_construct_level(writer &th)
 
     CANARY;
 
-    for (int count_x = 0; count_x < GXM; count_x++)
-        for (int count_y = 0; count_y < GYM; count_y++)
-        {
-            marshallByte(th, grd[count_x][count_y]);
-            marshallMapCell(th, env.map_knowledge[count_x][count_y]);
-            marshallInt(th, env.pgrid[count_x][count_y].flags);
-        }
+    _marshall_buffered(th, GXM * GYM * 8, [](writer &cells)
+    {
+        for (int count_x = 0; count_x < GXM; count_x++)
+            for (int count_y = 0; count_y < GYM; count_y++)
+            {
+                marshallByte(cells, grd[count_x][count_y]);
+                marshallMapCell(cells,
+                                env.map_knowledge[count_x][count_y]);
+                marshallInt(cells, env.pgrid[count_x][count_y].flags);
+            }
+    });
 
     marshallBoolean(th, !!env.map_forgotten.get());
     if (env.map_forgotten.get())
-        for (int x = 0; x < GXM; x++)
-            for (int y = 0; y < GYM; y++)
-                marshallMapCell(th, (*env.map_forgotten)[x][y]);
+    {
+        _marshall_buffered(th, GXM * GYM * 4, [](writer &cells)
+        {
+            for (int x = 0; x < GXM; x++)
+                for (int y = 0; y < GYM; y++)
+                    marshallMapCell(cells, (*env.map_forgotten)[x][y]);
+        });
+    }
 
     _run_length_encode(th, marshallByte, env.grid_colours, GXM, GYM);
 
@@ -4098,11 +4255,7 @@ static void tag_construct_level(writer &th)
     // Save heightmap, if present.
     marshallByte(th, !!env.heightmap.get());
     if (env.heightmap.get())
-    {
-        grid_heightmap &heightmap(*env.heightmap);
-        for (rectangle_iterator ri(0); ri; ++ri)
-            marshallShort(th, heightmap(*ri));
-    }
+        _marshall_int_grid<int16_t>(th, *env.heightmap, GXM, GYM);
 
     CANARY;
 
@@ -5432,18 +5585,22 @@ void tag_construct_level_tiles(writer &th)
     marshallShort(th, env.tile_default.floor);
     marshallShort(th, env.tile_default.special);
 
-    for (int count_x = 0; count_x < GXM; count_x++)
-        for (int count_y = 0; count_y < GYM; count_y++)
-        {
-            marshallShort(th, env.tile_flv[count_x][count_y].wall_idx);
-            marshallShort(th, env.tile_flv[count_x][count_y].floor_idx);
-            marshallShort(th, env.tile_flv[count_x][count_y].feat_idx);
-
-            marshallShort(th, env.tile_flv[count_x][count_y].wall);
-            marshallShort(th, env.tile_flv[count_x][count_y].floor);
-            marshallShort(th, env.tile_flv[count_x][count_y].feat);
-            marshallShort(th, env.tile_flv[count_x][count_y].special);
-        }
+    _marshall_buffered(th, GXM * GYM * 14, [](writer &cells)
+    {
+        for (int count_x = 0; count_x < GXM; count_x++)
+            for (int count_y = 0; count_y < GYM; count_y++)
+            {
+                const tile_flavour &flv = env.tile_flv[count_x][count_y];
+                marshallShort(cells, flv.wall_idx);
+                marshallShort(cells, flv.floor_idx);
+                marshallShort(cells, flv.feat_idx);
+
+                marshallShort(cells, flv.wall);
+                marshallShort(cells, flv.floor);
+                marshallShort(cells, flv.feat);
+                marshallShort(cells, flv.special);
+            }
+    });
 
     marshallInt(th, TILE_WALL_MAX);
 }
@@ -5616,9 +5773,7 @@ static void tag_read_level(reader &th)
     if (have_heightmap)
     {
         env.heightmap.reset(new grid_heightmap);
-        grid_heightmap &heightmap(*env.heightmap);
-        for (rectangle_iterator ri(0); ri; ++ri)
-            heightmap(*ri) = unmarshallShort(th);
+        _unmarshall_int_grid<int16_t>(th, *env.heightmap, GXM, GYM);
     }
 
     EAT_CANARY;
@@ -6300,18 +6455,22 @@ void tag_read_level_tiles(reader &th)
     env.tile_default.floor     = unmarshallShort(th);
     env.tile_default.special   = unmarshallShort(th);
 
+    // Seven shorts a cell: read the lot at once and unmarshall from memory.
+    vector<unsigned char> flavours(gx * gy * 7 * 2);
+    th.read(flavours.data(), flavours.size());
+    reader cells(flavours, th.getMinorVersion());
     for (int x = 0; x < gx; x++)
         for (int y = 0; y < gy; y++)
         {
-            env.tile_flv[x][y].wall_idx  = unmarshallShort(th);
-            env.tile_flv[x][y].floor_idx = unmarshallShort(th);
-            env.tile_flv[x][y].feat_idx  = unmarshallShort(th);
+            env.tile_flv[x][y].wall_idx  = unmarshallShort(cells);
+            env.tile_flv[x][y].floor_idx = unmarshallShort(cells);
+            env.tile_flv[x][y].feat_idx  = unmarshallShort(cells);
 
             // These get overwritten by _regenerate_tile_flavour
-            env.tile_flv[x][y].wall    = unmarshallShort(th);
-            env.tile_flv[x][y].floor   = unmarshallShort(th);
-            env.tile_flv[x][y].feat    = unmarshallShort(th);
-            env.tile_flv[x][y].special = unmarshallShort(th);
+            env.tile_flv[x][y].wall    = unmarshallShort(cells);
+            env.tile_flv[x][y].floor   = unmarshallShort(cells);
+            env.tile_flv[x][y].feat    = unmarshallShort(cells);
+            env.tile_flv[x][y].special = unmarshallShort(cells);
         }
 
     _debug_count_tiles();
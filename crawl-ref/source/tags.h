@@ -27,6 +27,9 @@ enum tag_type   // used during save/load process to identify data blocks
     TAG_SKIP
 };
 
+// Bytes staged between a reader/writer and its save chunk's zlib stream.
+#define TAG_STAGE_SIZE 16384
+
 /* ***********************************************************************
  * writer API
  * *********************************************************************** */
@@ -36,22 +39,20 @@ class writer
 public:
     writer(const string &filename, FILE* output, bool ignore_errors = false)
         : _filename(filename), _file(output), _chunk(0),
-          _ignore_errors(ignore_errors), _pbuf(0), failed(false)
+          _ignore_errors(ignore_errors), _pbuf(0), _async_save(0),
+          failed(false)
     {
         ASSERT(output);
     }
     writer(vector<unsigned char>* poutput)
         : _filename(), _file(0), _chunk(0), _ignore_errors(false),
-          _pbuf(poutput), failed(false) { ASSERT(poutput); }
-    writer(package *save, const string &chunkname)
-        : _filename(), _file(0), _chunk(0), _ignore_errors(false),
-          failed(false)
+          _pbuf(poutput), _async_save(0), failed(false)
     {
-        ASSERT(save);
-        _chunk = save->writer(chunkname);
+        ASSERT(poutput);
     }
+    writer(package *save, const string &chunkname);
 
-    ~writer() { if (_chunk) delete _chunk; }
+    ~writer();
 
     void writeByte(unsigned char byte);
     void write(const void *data, size_t size);
@@ -61,6 +62,7 @@ public:
 
 private:
     void check_ok(bool ok);
+    void flush_stage();
 
 private:
     string _filename;
@@ -69,6 +71,13 @@ private:
     bool _ignore_errors;
 
     vector<unsigned char>* _pbuf;
+    // For a package that saves in the background, the chunk is collected
+    // in _stage and handed over whole once we're done.
+    package *_async_save;
+    string _chunkname;
+    // Chunk output is collected here and handed to zlib in large blocks,
+    // rather than a deflate() call for every byte of every field.
+    vector<unsigned char> _stage;
 
     bool failed;
 };
@@ -98,11 +107,13 @@ public:
     reader(const string &filename, int minorVersion = TAG_MINOR_INVALID);
     reader(FILE* input, int minorVersion = TAG_MINOR_INVALID)
         : _file(input), _chunk(0), opened_file(false), _pbuf(0),
-          _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
+          _read_offset(0), _stage_pos(0), _minorVersion(minorVersion),
+          _safe_read(false) {}
     reader(const vector<unsigned char>& input,
            int minorVersion = TAG_MINOR_INVALID)
         : _file(0), _chunk(0), opened_file(false), _pbuf(&input),
-          _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
+          _read_offset(0), _stage_pos(0), _minorVersion(minorVersion),
+          _safe_read(false) {}
     reader(package *save, const string &chunkname,
            int minorVersion = TAG_MINOR_INVALID);
     ~reader();
@@ -120,6 +131,9 @@ public:
 
     void set_safe_read(bool setting) { _safe_read = setting; }
 
+private:
+    bool fill_stage();
+
 private:
     string _filename;
     FILE* _file;
@@ -127,6 +141,10 @@ private:
     bool  opened_file;
     const vector<unsigned char>* _pbuf;
     unsigned int _read_offset;
+    // Chunk input inflated ahead of the reader, and how much of it has
+    // been consumed.
+    vector<unsigned char> _stage;
+    size_t _stage_pos;
     int _minorVersion;
     // always throw an exception rather than dying when reading past EOF
     bool _safe_read;
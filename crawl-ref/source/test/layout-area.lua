@@ -0,0 +1,342 @@
+-- Check the bulk map operations of the dgn build library (get_area,
+-- set_area, replace_area, neighbor_counts, flood_fill, fill_small_zones)
+-- and the layout code moved onto them, each against the cell-by-cell
+-- mapgrd loop it stands in for.
+
+require("dlua/layout/zonify.lua")
+require("dlua/layout/procedural.lua")
+
+local checks = 0
+local iters  = 5
+
+local map = dgn.map_by_name("layout_area_test")
+assert(map, "Could not find layout_area_test map")
+local e = dgn_map_meta_wrap(map, dgn)
+
+local gxm, gym = dgn.max_bounds()
+e.extend_map { width = gxm, height = gym, fill = 'x' }
+
+-- The whole map, read a cell at a time, as a list of row strings.
+local function snapshot()
+  local rows = {}
+  for y = 0, gym - 1 do
+    local row = {}
+    for x = 0, gxm - 1 do
+      row[x + 1] = e.mapgrd[x][y]
+    end
+    rows[y + 1] = table.concat(row)
+  end
+  return rows
+end
+
+local function restore(rows)
+  for y = 0, gym - 1 do
+    for x = 0, gxm - 1 do
+      e.mapgrd[x][y] = string.sub(rows[y + 1], x + 1, x + 1)
+    end
+  end
+end
+
+local function same_map(expected, what)
+  local actual = snapshot()
+  for y = 1, gym do
+    test.eq(actual[y], expected[y], what .. ", row " .. (y - 1))
+  end
+  checks = checks + 1
+end
+
+-- A cave-like mess of rock, floor, lava and water, walled in.
+local function randomise()
+  for x = 0, gxm - 1 do
+    for y = 0, gym - 1 do
+      local glyph = 'x'
+      if x > 0 and y > 0 and x < gxm - 1 and y < gym - 1 then
+        local roll = crawl.random2(100)
+        glyph = roll < 42 and 'x' or roll < 47 and 'l'
+                or roll < 50 and 'w' or '.'
+      end
+      e.mapgrd[x][y] = glyph
+    end
+  end
+end
+
+local function random_area()
+  local x1, y1 = crawl.random2(gxm), crawl.random2(gym)
+  local x2, y2 = crawl.random2(gxm), crawl.random2(gym)
+  return math.min(x1, x2), math.min(y1, y2),
+         math.max(x1, x2), math.max(y1, y2)
+end
+
+local function test_get_area()
+  local x1, y1, x2, y2 = random_area()
+  local rows = e.get_area { x1 = x1, y1 = y1, x2 = x2, y2 = y2 }
+  local arrays = e.get_area { x1 = x1, y1 = y1, x2 = x2, y2 = y2,
+                              arrays = true }
+  test.eq(#rows, y2 - y1 + 1, "get_area rows")
+  test.eq(#arrays, y2 - y1 + 1, "get_area arrays")
+  for y = y1, y2 do
+    local row = {}
+    for x = x1, x2 do
+      row[x - x1 + 1] = e.mapgrd[x][y]
+      test.eq(arrays[y - y1 + 1][x - x1 + 1], e.mapgrd[x][y],
+              "get_area arrays at " .. x .. "," .. y)
+    end
+    test.eq(rows[y - y1 + 1], table.concat(row),
+            "get_area row " .. y)
+  end
+  checks = checks + 1
+end
+
+local function test_set_area()
+  local before = snapshot()
+  local x1, y1, x2, y2 = random_area()
+  local width = x2 - x1 + 1
+
+  -- Lists with holes and transparent cells...
+  local rows = {}
+  for y = y1, y2 do
+    local row = {}
+    for x = x1, x2 do
+      local roll = crawl.random2(4)
+      row[x - x1 + 1] = roll == 0 and '.' or roll == 1 and '?'
+                        or roll == 2 and 'c' or nil
+    end
+    rows[y - y1 + 1] = row
+  end
+
+  for y = y1, y2 do
+    for x = x1, x2 do
+      local glyph = rows[y - y1 + 1][x - x1 + 1]
+      if glyph ~= nil and glyph ~= '?' then e.mapgrd[x][y] = glyph end
+    end
+  end
+  local expected = snapshot()
+
+  restore(before)
+  e.set_area { x1 = x1, y1 = y1, width = width, rows = rows,
+               transparent = '?' }
+  same_map(expected, "set_area lists")
+
+  -- ...and a newline-separated string.
+  restore(before)
+  local lines = {}
+  for y = y1, y2 do
+    local row = {}
+    for x = x1, x2 do
+      row[x - x1 + 1] = crawl.coinflip() and 'v' or 'b'
+      e.mapgrd[x][y] = row[x - x1 + 1]
+    end
+    lines[y - y1 + 1] = table.concat(row)
+  end
+  expected = snapshot()
+
+  restore(before)
+  e.set_area { x1 = x1, y1 = y1, rows = table.concat(lines, "\n") }
+  same_map(expected, "set_area string")
+end
+
+local function test_replace_area()
+  local before = snapshot()
+  local x1, y1, x2, y2 = random_area()
+
+  local mask = {}
+  for y = y1, y2 do
+    local row = {}
+    for x = x1, x2 do
+      row[x - x1 + 1] = crawl.coinflip() and '*' or ' '
+    end
+    mask[y - y1 + 1] = table.concat(row)
+  end
+
+  for y = y1, y2 do
+    for x = x1, x2 do
+      if string.sub(mask[y - y1 + 1], x - x1 + 1, x - x1 + 1) ~= ' '
+         and (e.mapgrd[x][y] == '.' or e.mapgrd[x][y] == 'l') then
+        e.mapgrd[x][y] = 't'
+      end
+    end
+  end
+  local expected = snapshot()
+
+  restore(before)
+  e.replace_area { x1 = x1, y1 = y1, x2 = x2, y2 = y2, find = ".l",
+                   replace = 't', mask = mask }
+  same_map(expected, "replace_area with a mask")
+end
+
+local function test_neighbor_counts()
+  local x1, y1, x2, y2 = random_area()
+  local counts = e.neighbor_counts { x1 = x1, y1 = y1, x2 = x2, y2 = y2,
+                                     find = "xw" }
+  for x = x1, x2 do
+    for y = y1, y2 do
+      local count = 0
+      for dx = -1, 1 do
+        for dy = -1, 1 do
+          local nx, ny = x + dx, y + dy
+          if (dx ~= 0 or dy ~= 0)
+             and nx >= 0 and ny >= 0 and nx < gxm and ny < gym
+             and (e.mapgrd[nx][ny] == 'x' or e.mapgrd[nx][ny] == 'w') then
+            count = count + 1
+          end
+        end
+      end
+      test.eq(counts[x][y], count, "neighbor_counts at " .. x .. "," .. y)
+    end
+  end
+  checks = checks + 1
+end
+
+-- The same fill, a queue at a time through mapgrd.
+local function slow_flood_fill(x, y, fill, passes, diagonal)
+  local seen, queue = {}, {}
+  local function key(px, py) return py * gxm + px end
+  if passes(e.mapgrd[x][y], x, y) then
+    queue[1] = { x = x, y = y }
+    seen[key(x, y)] = true
+  end
+  local i = 1
+  while i <= #queue do
+    local c = queue[i]
+    for dy = -1, 1 do
+      for dx = -1, 1 do
+        local nx, ny = c.x + dx, c.y + dy
+        if (dx ~= 0 or dy ~= 0) and (diagonal or dx == 0 or dy == 0)
+           and nx >= 0 and ny >= 0 and nx < gxm and ny < gym
+           and not seen[key(nx, ny)] then
+          seen[key(nx, ny)] = true
+          if passes(e.mapgrd[nx][ny], nx, ny) then
+            queue[#queue + 1] = { x = nx, y = ny }
+          end
+        end
+      end
+    end
+    i = i + 1
+  end
+  for _, c in ipairs(queue) do
+    e.mapgrd[c.x][c.y] = fill
+  end
+  return #queue
+end
+
+local function test_flood_fill()
+  local before = snapshot()
+  local x, y = 1 + crawl.random2(gxm - 2), 1 + crawl.random2(gym - 2)
+
+  local function floor(glyph) return glyph == '.' or glyph == 'l' end
+  local n = slow_flood_fill(x, y, 'c', floor, true)
+  local expected = snapshot()
+  restore(before)
+  test.eq(e.flood_fill { x = x, y = y, fill = 'c', passable = ".l" }, n,
+          "flood_fill count")
+  same_map(expected, "flood_fill with glyphs")
+
+  local function striped(glyph, px, py)
+    return glyph == '.' and px % 7 ~= 0
+  end
+  restore(before)
+  n = slow_flood_fill(x, y, 'b', striped, false)
+  expected = snapshot()
+  restore(before)
+  test.eq(e.flood_fill { x = x, y = y, fill = 'b', passable = striped,
+                         diagonal = false }, n,
+          "flood_fill predicate count")
+  same_map(expected, "flood_fill with a predicate")
+end
+
+-- zonify.map_fill_zones and map_fill_lava_zones as they were, through
+-- zonify.map and mapgrd.
+local function slow_fill_zones(num_to_keep, glyph, min_zone_size, wall)
+  local zonemap = zonify.map(
+    { x1 = 1, y1 = 1, x2 = gxm-2, y2 = gym-2 },
+    function(x,y)
+      return dgn.in_bounds(x,y) and { glyph = e.mapgrd[x][y] } or nil
+    end,
+    function(val)
+      return string.find(wall,val.glyph,1,true) and "wall" or "floor"
+    end
+  )
+  zonify.fill_smallest_zones(zonemap, num_to_keep, "floor",
+                             function(x,y,cell) e.mapgrd[x][y] = glyph end,
+                             min_zone_size)
+end
+
+local function test_fill_zones()
+  local before = snapshot()
+  local keep = 1 + crawl.random2(3)
+  local min_size = crawl.coinflip() and 1 or 10
+
+  slow_fill_zones(keep, 'x', min_size, "wlxcvbtg")
+  local expected = snapshot()
+  restore(before)
+  zonify.map_fill_zones(e, keep, 'x', min_size)
+  same_map(expected, "map_fill_zones")
+
+  restore(before)
+  slow_fill_zones(keep, 'v', min_size, "wxcvbtg")
+  expected = snapshot()
+  restore(before)
+  zonify.map_fill_lava_zones(e, keep, 'v', min_size)
+  same_map(expected, "map_fill_lava_zones")
+end
+
+local function test_render()
+  local before = snapshot()
+  local calls = {}
+  local function fval(x, y)
+    calls[#calls + 1] = x .. "," .. y
+    return ((x * 7 + y * 3) % 11) / 10
+  end
+  local function fresult(val, x, y)
+    if val < 0.3 then return nil end
+    return val < 0.7 and '.' or 'x'
+  end
+
+  -- procedural.render_map as it was.
+  for x = 1, gxm - 2 do
+    for y = 1, gym - 2 do
+      local r = fresult(fval(x, y), x, y)
+      if r ~= nil then e.mapgrd[x][y] = r end
+    end
+  end
+  local expected, order = snapshot(), calls
+
+  restore(before)
+  calls = {}
+  procedural.render_map(e, fval, fresult)
+  same_map(expected, "render_map")
+  test.eq(table.concat(calls, " "), table.concat(order, " "),
+          "render_map call order")
+
+  -- procedural.render_map_area as it was.
+  local x1, y1, x2, y2 = random_area()
+  local function fareaval(dx, dy, x, y) return fval(x, y) * 2 end
+  restore(before)
+  calls = {}
+  for x = x1, x2 do
+    for y = y1, y2 do
+      e.mapgrd[x][y] = fareaval(x - x1, y - y1, x, y) <= 1 and '.' or 'x'
+    end
+  end
+  expected, order = snapshot(), calls
+
+  restore(before)
+  calls = {}
+  procedural.render_map_area(e, x1, y1, x2, y2, fareaval, '.', 'x')
+  same_map(expected, "render_map_area")
+  test.eq(table.concat(calls, " "), table.concat(order, " "),
+          "render_map_area call order")
+end
+
+for i = 1, iters do
+  randomise()
+  test_get_area()
+  test_set_area()
+  test_replace_area()
+  test_neighbor_counts()
+  test_flood_fill()
+  test_fill_zones()
+  test_render()
+end
+
+assert(checks > 0, "No layout area checks were made")
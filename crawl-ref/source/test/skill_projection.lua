@@ -0,0 +1,37 @@
+-- Check that projecting skill training in one go gives exactly what
+-- training one step at a time does, for random training and experience.
+
+local niters = 200
+
+local names = { }
+for name, _ in pairs(you.project_training(0)) do
+  table.insert(names, name)
+end
+table.sort(names)
+
+local function check_projection(iter)
+  for i = 1, crawl.random_range(1, 30) do
+    you.exercise(names[crawl.random_range(1, #names)])
+  end
+
+  -- Mostly what a character might have to spend, sometimes enough to
+  -- take skills to 27.
+  local xp = crawl.one_chance_in(10) and crawl.random2(2000000)
+             or crawl.random2(100000)
+
+  local points, levels = you.project_training(xp)
+  local step_points, step_levels = you.project_training(xp, true)
+  for _, name in ipairs(names) do
+    if points[name] ~= step_points[name]
+       or levels[name] ~= step_levels[name] then
+      error("Projecting " .. xp .. " XP (iter #" .. iter .. ") gives " ..
+            name .. " " .. points[name] .. " points (level " ..
+            levels[name] .. "), but training step by step gives " ..
+            step_points[name] .. " (level " .. step_levels[name] .. ")")
+    end
+  end
+end
+
+for i = 1, niters do
+  check_projection(i)
+end
@@ -32,6 +32,7 @@
 #include "notes.h"
 #include "options.h"
 #include "player.h"
+#include "profiler.h"
 #include "religion.h"
 #include "skills.h"
 #include "state.h"
@@ -1386,6 +1387,8 @@ void TilesFramework::_mcache_ref(bool inc)
 
 void TilesFramework::_send_map(bool force_full)
 {
+    PROF_ZONE("send_map");
+
     map<uint32_t, coord_def> new_monster_locs;
 
     force_full = force_full || m_need_full_map;
@@ -18,6 +18,7 @@
 #include <set>
 #include <sstream>
 
+#include "bench.h"
 #include "branch.h"
 #include "cloud.h"
 #include "clua.h"
@@ -50,6 +51,7 @@
 #include "output.h"
 #include "place.h"
 #include "prompt.h"
+#include "profiler.h"
 #include "religion.h"
 #include "stairs.h"
 #include "state.h"
@@ -1119,6 +1121,8 @@ const coord_def travel_pathfind::unexplored_square() const
 // Allison - used with his permission.
 coord_def travel_pathfind::pathfind(run_mode_type rmode, bool fallback_explore)
 {
+    PROF_ZONE("travel_pathfind");
+    ++bench_counts.pathfinds;
     unwind_bool saved_ipt(ignore_player_traversability);
 
     if (rmode == RMODE_INTERLEVEL)
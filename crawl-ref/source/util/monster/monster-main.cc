@@ -34,8 +34,15 @@
 #include "stringutil.h"
 #include "syscalls.h"
 #include "artefact.h"
+#include <chrono>
+#include <csetjmp>
+#include <csignal>
+#include <fcntl.h>
 #include <sstream>
 #include <set>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 const coord_def MONSTER_PLACE(20, 20);
@@ -245,6 +252,18 @@ static void mons_check_flag(bool set, string& flag,
         mons_flag(flag, newflag);
 }
 
+static void _reset_dummy_level()
+{
+    dgn_reset_level();
+    for (rectangle_iterator ri(0); ri; ++ri)
+        grd(*ri) = DNGN_FLOOR;
+
+    los_changed();
+    you.hp = you.hp_max = PLAYER_MAXHP;
+    you.magic_points = you.max_magic_points = PLAYER_MAXMP;
+    you.species = SP_HUMAN;
+}
+
 static void initialize_crawl()
 {
     init_monsters();
@@ -260,14 +279,7 @@ static void initialize_crawl()
     init_element_colours();
     init_show_table(); // Initializes indices for get_feature_def.
 
-    dgn_reset_level();
-    for (rectangle_iterator ri(0); ri; ++ri)
-        grd(*ri) = DNGN_FLOOR;
-
-    los_changed();
-    you.hp = you.hp_max = PLAYER_MAXHP;
-    you.magic_points = you.max_magic_points = PLAYER_MAXMP;
-    you.species = SP_HUMAN;
+    _reset_dummy_level();
 }
 
 static string dice_def_string(dice_def dice)
@@ -686,39 +698,12 @@ static string canned_reports[][2] = {
                  " | Res: sanity | XP: ∞ | Int: god | Sz: !!!"))},
 };
 
-int main(int argc, char* argv[])
+// Print the stats for a monster, or what went wrong.
+//
+// @return the exit status for the query.
+static int _monster_report(string target)
 {
-    alarm(5);
-    crawl_state.test = true;
-    if (argc < 2)
-    {
-        printf("Usage: @? <monster name>\n");
-        return 0;
-    }
-
-    if (!strcmp(argv[1], "-version") || !strcmp(argv[1], "--version"))
-    {
-        printf("Monster stats Crawl version: %s\n", Version::Long);
-        return 0;
-    }
-    else if (!strcmp(argv[1], "-name") || !strcmp(argv[1], "--name"))
-    {
-        seed_rng();
-        printf("%s\n", make_name().c_str());
-        return 0;
-    }
-
-    initialize_crawl();
-
     mons_list mons;
-    string target = argv[1];
-
-    if (argc > 2)
-        for (int x = 2; x < argc; x++)
-        {
-            target.append(" ");
-            target.append(argv[x]);
-        }
 
     trim_string(target);
 
@@ -1295,6 +1280,262 @@ int main(int argc, char* argv[])
     return 1;
 }
 
+// The random number generators as initialize_crawl() left them.
+static vector<PcgRNG> initial_rngs;
+
+// Put the level, the player and the random number generators back to how
+// initialize_crawl() left them, so every query starts from the same state.
+static void _reset_query_state()
+{
+    _reset_dummy_level();
+    set_rng_states(initial_rngs);
+}
+
+// Where a query that runs out its alarm jumps back to.
+static sigjmp_buf query_timeout;
+static volatile sig_atomic_t in_query = 0;
+
+static void _query_alarm(int)
+{
+    if (in_query)
+        siglongjmp(query_timeout, 1);
+    _exit(1);
+}
+
+// Answer one query per line until the end of the input. Each answer is
+// exactly what a separate run would print, and a line of its own. A query
+// that takes too long is abandoned with an error line instead of taking
+// the whole server down with it.
+static void _serve_stream(FILE *in)
+{
+    struct sigaction sa = {};
+    sa.sa_handler = _query_alarm;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, nullptr);
+
+    char *line = nullptr;
+    size_t size = 0;
+    while (getline(&line, &size, in) != -1)
+    {
+        string target = line;
+        trim_string(target);
+        if (target.empty())
+            continue;
+
+        _reset_query_state();
+        if (!sigsetjmp(query_timeout, 1))
+        {
+            in_query = 1;
+            alarm(5);
+            _monster_report(target);
+        }
+        else
+            printf("\nQuery timed out: %s\n", target.c_str());
+        alarm(0);
+        in_query = 0;
+        fflush(stdout);
+    }
+    free(line);
+}
+
+// Serve connections one after another, with stdout pointing at the
+// current one.
+static void _serve_worker(int listener)
+{
+    signal(SIGPIPE, SIG_IGN);
+    const int saved_stdout = dup(STDOUT_FILENO);
+    while (true)
+    {
+        const int conn = accept(listener, nullptr, nullptr);
+        if (conn < 0)
+            continue;
+
+        FILE *in = fdopen(conn, "r");
+        if (!in)
+        {
+            close(conn);
+            continue;
+        }
+
+        fflush(stdout);
+        dup2(conn, STDOUT_FILENO);
+        _serve_stream(in);
+        fflush(stdout);
+        // Let go of our copy of the connection too, or the client never
+        // sees it close.
+        dup2(saved_stdout, STDOUT_FILENO);
+        fclose(in);
+    }
+}
+
+static pid_t _start_worker(int listener)
+{
+    const pid_t pid = fork();
+    if (!pid)
+    {
+        _serve_worker(listener);
+        _exit(0);
+    }
+    return pid;
+}
+
+// Listen on a UNIX socket, with a pool of forked workers that all inherit
+// the initialised tables and accept connections in turn. A worker that
+// dies (a query that crashes, say) is replaced.
+static int _serve_socket(const string &path, int workers)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.length() >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path.c_str());
+        return 1;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0
+        || ::bind(listener, (sockaddr *) &addr, sizeof(addr)) < 0
+        || listen(listener, 64) < 0)
+    {
+        fprintf(stderr, "Couldn't listen on %s: %s\n", path.c_str(),
+                strerror(errno));
+        return 1;
+    }
+
+    for (int i = 0; i < workers; ++i)
+        _start_worker(listener);
+
+    while (true)
+    {
+        int status;
+        if (wait(&status) > 0)
+            _start_worker(listener);
+        else if (errno == ECHILD)
+            return 1;
+    }
+}
+
+static double _seconds_since(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+           .count();
+}
+
+// Time <count> lookups of <target>, first as one process per query and
+// then answered by a single initialised process as -serve does, and
+// print the queries per second of each. Query output is discarded.
+static int _serve_benchmark(const char *self, const string &target,
+                            int count)
+{
+    fflush(stdout);
+    const int saved_stdout = dup(STDOUT_FILENO);
+    const int devnull = open("/dev/null", O_WRONLY);
+    if (devnull < 0)
+    {
+        fprintf(stderr, "Couldn't open /dev/null: %s\n", strerror(errno));
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        const pid_t pid = fork();
+        if (!pid)
+        {
+            dup2(devnull, STDOUT_FILENO);
+            execlp(self, self, target.c_str(), (char *) nullptr);
+            _exit(127);
+        }
+        int status;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0)
+        {
+            fprintf(stderr, "Couldn't run %s: %s\n", self, strerror(errno));
+            return 1;
+        }
+    }
+    const double per_process = count / _seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    dup2(devnull, STDOUT_FILENO);
+    initialize_crawl();
+    initial_rngs = get_rng_states();
+    for (int i = 0; i < count; ++i)
+    {
+        _reset_query_state();
+        _monster_report(target);
+    }
+    fflush(stdout);
+    const double served = count / _seconds_since(start);
+
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(devnull);
+    printf("%d queries for \"%s\":\n", count, target.c_str());
+    printf("  one process per query: %8.1f queries/s\n", per_process);
+    printf("  -serve:                %8.1f queries/s (startup included)\n",
+           served);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    crawl_state.test = true;
+    if (argc < 2)
+    {
+        printf("Usage: @? <monster name>\n"
+               "       @? -serve [<socket> [<workers>]]\n"
+               "       @? -bench <monster name> [<count>]\n");
+        return 0;
+    }
+
+    if (!strcmp(argv[1], "-version") || !strcmp(argv[1], "--version"))
+    {
+        printf("Monster stats Crawl version: %s\n", Version::Long);
+        return 0;
+    }
+    else if (!strcmp(argv[1], "-name") || !strcmp(argv[1], "--name"))
+    {
+        seed_rng();
+        printf("%s\n", make_name().c_str());
+        return 0;
+    }
+    else if (!strcmp(argv[1], "-serve") || !strcmp(argv[1], "--serve"))
+    {
+        // Initialise once, then answer queries from stdin or a socket.
+        initialize_crawl();
+        initial_rngs = get_rng_states();
+        if (argc < 3)
+        {
+            _serve_stream(stdin);
+            return 0;
+        }
+        return _serve_socket(argv[2], argc > 3 ? max(1, atoi(argv[3])) : 4);
+    }
+    else if (!strcmp(argv[1], "-bench") || !strcmp(argv[1], "--bench"))
+    {
+        if (argc < 3)
+        {
+            printf("Usage: @? -bench <monster name> [<count>]\n");
+            return 1;
+        }
+        return _serve_benchmark(argv[0], argv[2],
+                                argc > 3 ? max(1, atoi(argv[3])) : 100);
+    }
+
+    alarm(5);
+    initialize_crawl();
+
+    string target = argv[1];
+    for (int x = 2; x < argc; x++)
+    {
+        target.append(" ");
+        target.append(argv[x]);
+    }
+
+    return _monster_report(target);
+}
+
 //////////////////////////////////////////////////////////////////////////
 // main.cc stuff
 
@@ -40,6 +40,7 @@
 #include "item-name.h" // item_type_known
 #include "item-prop.h" // get_weapon_brand
 #include "item-status-flag-type.h"
+#include "keylog.h"
 #include "libutil.h"
 #include "macro.h"
 #include "map-knowledge.h"
@@ -55,6 +56,7 @@
 #include "options.h"
 #include "output.h"
 #include "player.h"
+#include "profiler.h"
 #include "random.h"
 #include "religion.h"
 #include "shout.h"
@@ -1353,6 +1355,8 @@ void run_animation(animation_type anim, use_animation_type type, bool cleanup)
  */
 void viewwindow(bool show_updates, bool tiles_only, animation *a)
 {
+    PROF_ZONE("viewwindow");
+
     // The player could be at (0,0) if we are called during level-gen; this can
     // happen via mpr -> interrupt_activity -> stop_delay -> runrest::stop
     if (you.duration[DUR_TIME_STEP] || you.pos().origin())
@@ -1396,7 +1400,7 @@ void viewwindow(bool show_updates, bool tiles_only, animation *a)
     bool run_dont_draw = you.running && Options.travel_delay < 0
                 && (!you.running.is_explore() || Options.explore_delay < 0);
 
-    if (run_dont_draw || you.asleep())
+    if (run_dont_draw || you.asleep() || keylog_replaying())
     {
         // Reset env.show if we munged it.
         if (_layers != LAYERS_ALL)
@@ -8,12 +8,17 @@
 #include "wiz-fsim.h"
 
 #include <cerrno>
+#ifndef TARGET_OS_WINDOWS
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
 
 #include "beam.h"
 #include "bitary.h"
 #include "coordit.h"
 #include "dbg-util.h"
 #include "directn.h"
+#include "end.h"
 #include "env.h"
 #include "fight.h"
 #include "item-prop.h"
@@ -31,13 +36,16 @@
 #include "mon-util.h"
 #include "options.h"
 #include "output.h"
+#include "package.h"
 #include "player-equip.h"
 #include "player.h"
+#include "random.h"
 #include "ranged-attack.h"
 #include "skills.h"
 #include "species.h"
 #include "state.h"
 #include "stringutil.h"
+#include "syscalls.h"
 #include "throw.h"
 #include "unwind.h"
 #include "version.h"
@@ -236,7 +244,8 @@ static bool _fsim_kit_equip(const string &kit, string &error)
         }
     }
 
-    redraw_screen();
+    if (crawl_state.io_inited)
+        redraw_screen();
     return true;
 }
 
@@ -315,7 +324,8 @@ static monster* _init_fsim()
     mon->hit_points = mon->max_hit_points = MAX_MONSTER_HP;
     mon->behaviour = BEH_SEEK;
 
-    redraw_screen();
+    if (crawl_state.io_inited)
+        redraw_screen();
 
     return mon;
 }
@@ -559,7 +569,7 @@ static void _fsim_simple_scale(FILE * o, monster* mon, bool defense)
         fflush(o);
 
         // kill the loop if the user hits escape
-        if (kbhit() && getchk() == 27)
+        if (crawl_state.io_inited && kbhit() && getchk() == 27)
         {
             mpr("Cancelling simulation.\n");
             fprintf(o, "Simulation cancelled!\n\n");
@@ -605,7 +615,7 @@ static void _fsim_double_scale(FILE * o, monster* mon, bool defense)
             fflush(o);
 
             // kill the loop if the user hits escape
-            if (kbhit() && getchk() == 27)
+            if (crawl_state.io_inited && kbhit() && getchk() == 27)
             {
                 mpr("Cancelling simulation.\n");
                 fprintf(o, "\nSimulation cancelled!\n\n");
@@ -616,23 +626,9 @@ static void _fsim_double_scale(FILE * o, monster* mon, bool defense)
     }
 }
 
-void wizard_fight_sim(bool double_scale)
+// Whether fsim_mode asks for defense; false if it doesn't say.
+static bool _fsim_mode_set(bool &defense)
 {
-    monster * mon = _init_fsim();
-    if (!mon)
-        return;
-
-    bool defense = false;
-    const char * fightstat = Options.fsim_csv ? "fsim.csv" : "fsim.txt";
-
-    FILE * o = fopen(fightstat, "a");
-    if (!o)
-    {
-        mprf(MSGCH_ERROR, "Can't write %s: %s", fightstat, strerror(errno));
-        _uninit_fsim(mon);
-        return;
-    }
-
     if (Options.fsim_mode.find("defen") != string::npos)
         defense = true;
     else if (Options.fsim_mode.find("attack") != string::npos
@@ -641,26 +637,16 @@ void wizard_fight_sim(bool double_scale)
         defense = false;
     }
     else
-    {
-        mprf(MSGCH_PROMPT, "(A)ttack or (D)efense?");
-
-        switch (toalower(getchk()))
-        {
-        case 'a':
-        case 'A':
-            defense = false;
-            break;
-        case 'd':
-        case 'D':
-            defense = true;
-            break;
-        default:
-            canned_msg(MSG_OK);
-            _uninit_fsim(mon);
-            return;
-        }
-    }
+        return false;
+    return true;
+}
 
+// Write a matchup's header and its scales, for every kit, to o.
+//
+// @return false if a kit couldn't be equipped.
+static bool _fight_sim(FILE * o, monster* mon, bool defense,
+                       bool double_scale)
+{
     _write_version(o);
     _write_matchup(o, *mon, defense, Options.fsim_rounds);
     _write_you(o);
@@ -681,6 +667,7 @@ void wizard_fight_sim(bool double_scale)
     void (*fsim_proc)(FILE * o, monster* mon, bool defense) = nullptr;
     fsim_proc = double_scale ? _fsim_double_scale : _fsim_simple_scale;
 
+    bool ok = true;
     if (Options.fsim_kit.empty())
         fsim_proc(o, mon, defense);
     else
@@ -698,21 +685,265 @@ void wizard_fight_sim(bool double_scale)
                 mprf("Aborting sim on %s", kit.c_str());
                 if (error != "")
                     mpr(error);
+                ok = false;
                 break;
             }
         }
 
     if (!Options.fsim_csv)
         fprintf(o, "-----------------------------------\n\n");
-    fclose(o);
 
     skill_backup.restore_levels();
     skill_backup.restore_training();
     if (you.experience_level != xl)
         set_xl(xl, false);
 
+    return ok;
+}
+
+static const char *_fsim_file()
+{
+    return Options.fsim_csv ? "fsim.csv" : "fsim.txt";
+}
+
+void wizard_fight_sim(bool double_scale)
+{
+    monster * mon = _init_fsim();
+    if (!mon)
+        return;
+
+    bool defense = false;
+    const char * fightstat = _fsim_file();
+
+    FILE * o = fopen(fightstat, "a");
+    if (!o)
+    {
+        mprf(MSGCH_ERROR, "Can't write %s: %s", fightstat, strerror(errno));
+        _uninit_fsim(mon);
+        return;
+    }
+
+    if (!_fsim_mode_set(defense))
+    {
+        mprf(MSGCH_PROMPT, "(A)ttack or (D)efense?");
+
+        switch (toalower(getchk()))
+        {
+        case 'a':
+        case 'A':
+            defense = false;
+            break;
+        case 'd':
+        case 'D':
+            defense = true;
+            break;
+        default:
+            canned_msg(MSG_OK);
+            fclose(o);
+            _uninit_fsim(mon);
+            return;
+        }
+    }
+
+    _fight_sim(o, mon, defense, double_scale);
+    fclose(o);
+
     _uninit_fsim(mon);
     mpr("Done.");
 }
 
+/*
+ * Batches (-fsim <spec file>).
+ *
+ * Each line of the spec file is one matchup: init file options separated
+ * by semicolons, such as "fsim_mons = orc warrior; fsim_mode = attack;
+ * fsim_kit = long sword", and "double" for the two-skill table. fsim_mons
+ * and fsim_mode are needed, since there's nobody to ask.
+ *
+ * Every matchup runs in its own forked copy of the game as it stood when
+ * the batch started, so nothing a matchup does (the options it sets, the
+ * items and monster it makes, the skills it trains) has to be undone for
+ * the next. Its gameplay RNG is keyed on the game seed and its place in the
+ * file, so each matchup's results are the same however many workers run
+ * the batch. Workers write to part files, which are appended to fsim.csv
+ * (or fsim.txt) in spec file order once they are all done.
+ */
+struct fsim_matchup
+{
+    int line;
+    vector<string> options;
+    bool double_scale;
+};
+
+static vector<fsim_matchup> _read_fsim_spec(const string &file)
+{
+    FILE *f = fopen_u(file.c_str(), "r");
+    if (!f)
+        end(1, true, "Can't read fsim spec %s", file.c_str());
+
+    vector<fsim_matchup> matchups;
+    char buf[4096];
+    for (int line = 1; fgets(buf, sizeof(buf), f); ++line)
+    {
+        const string text = trimmed_string(buf);
+        if (text.empty() || text[0] == '#')
+            continue;
+
+        fsim_matchup matchup = { line, {}, false };
+        for (const string &option : split_string(";", text))
+        {
+            if (option == "double")
+                matchup.double_scale = true;
+            else
+                matchup.options.push_back(option);
+        }
+        matchups.push_back(matchup);
+    }
+    fclose(f);
+    return matchups;
+}
+
+#ifndef TARGET_OS_WINDOWS
+/**
+ * Body of a worker process: run one matchup, writing the results to path.
+ * Never returns; the exit status says whether the matchup ran.
+ */
+NORETURN static void _fsim_worker(const fsim_matchup &matchup, int index,
+                                  const string &path)
+{
+    crawl_state.fsim_worker = true;
+
+    for (const string &option : matchup.options)
+        Options.read_option_line(option);
+
+    bool defense = false;
+    if (get_monster_by_name(Options.fsim_mons, true) == MONS_PROGRAM_BUG)
+    {
+        fprintf(stderr, "fsim: line %d: unknown monster '%s'\n",
+                matchup.line, Options.fsim_mons.c_str());
+        _exit(1);
+    }
+    if (!_fsim_mode_set(defense))
+    {
+        fprintf(stderr, "fsim: line %d: fsim_mode must be attack or "
+                "defense\n", matchup.line);
+        _exit(1);
+    }
+
+    FILE *o = fopen_u(path.c_str(), "w");
+    if (!o)
+        _exit(1);
+
+    rng_subgenerator stream(Options.seed, index);
+    monster *mon = _init_fsim();
+    const bool ok = mon && _fight_sim(o, mon, defense, matchup.double_scale);
+    _exit(fclose(o) || !ok ? 1 : 0);
+}
+
+static bool _append_file(FILE *o, const string &path)
+{
+    FILE *in = fopen_u(path.c_str(), "r");
+    if (!in)
+        return false;
+
+    char buf[65536];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), in)) > 0)
+        fwrite(buf, 1, got, o);
+    fclose(in);
+    return true;
+}
+#endif
+
+/**
+ * Run every matchup in the -fsim spec file, crawl_state.fsim_jobs at a
+ * time, then exit.
+ */
+NORETURN void fsim_batch()
+{
+#ifdef TARGET_OS_WINDOWS
+    end(1, false, "-fsim is not available on Windows.");
+#else
+    const vector<fsim_matchup> matchups
+        = _read_fsim_spec(crawl_state.fsim_spec);
+
+    // Nothing is drawn from here on; progress goes to stderr.
+    cio_cleanup();
+    crawl_state.show_more_prompt = false;
+
+    int jobs = crawl_state.fsim_jobs;
+    if (jobs <= 0)
+        jobs = max(1, (int) sysconf(_SC_NPROCESSORS_ONLN));
+
+    const string fightstat = _fsim_file();
+    vector<string> parts;
+    for (size_t i = 0; i < matchups.size(); ++i)
+    {
+        parts.push_back(make_stringf("%s.%d.%u", fightstat.c_str(),
+                                     (int) getpid(), (unsigned int) i));
+    }
+
+    // Don't fork in the middle of a background save.
+    if (you.save)
+        you.save->flush();
+
+    map<pid_t, size_t> running;
+    vector<bool> done(matchups.size(), false);
+    size_t next = 0;
+    while (next < matchups.size() || !running.empty())
+    {
+        if (next < matchups.size() && (int) running.size() < jobs)
+        {
+            const pid_t pid = fork();
+            if (pid == -1)
+                end(1, true, "fsim: couldn't start a worker");
+            if (!pid)
+                _fsim_worker(matchups[next], next, parts[next]);
+            running[pid] = next++;
+            continue;
+        }
+
+        int status;
+        const pid_t pid = wait(&status);
+        if (pid == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        auto job = running.find(pid);
+        if (job == running.end())
+            continue;
+
+        const fsim_matchup &matchup = matchups[job->second];
+        done[job->second] = WIFEXITED(status) && !WEXITSTATUS(status);
+        fprintf(stderr, "fsim: line %d %s\n", matchup.line,
+                done[job->second] ? "done" : "failed");
+        running.erase(job);
+    }
+
+    FILE *o = fopen_u(fightstat.c_str(), "a");
+    if (!o)
+        end(1, true, "Can't write %s", fightstat.c_str());
+
+    int failed = 0;
+    for (size_t i = 0; i < matchups.size(); ++i)
+    {
+        if (!done[i] || !_append_file(o, parts[i]))
+            failed++;
+        unlink_u(parts[i].c_str());
+    }
+    fclose(o);
+
+    if (failed)
+    {
+        end(1, false, "fsim: %d of %d matchups failed",
+            failed, (int) matchups.size());
+    }
+    end(0, false, "fsim: %d matchups appended to %s",
+        (int) matchups.size(), fightstat.c_str());
+#endif
+}
+
 #endif
@@ -0,0 +1,232 @@
+/**
+ * @file
+ * @brief Filtered queries over xlog files (score files and logfiles)
+ *        without parsing every entry.
+ *
+ * The file is scanned in place: lines are found with memchr, and only the
+ * fields a query looks at are picked out of each line (and only their
+ * values are unescaped). Selecting takes the first K matching lines in
+ * file order and stops scanning there. Nothing is copied out of the file
+ * until the caller parses the handful of entries it actually shows.
+**/
+
+#include "AppHdr.h"
+
+#include "xlog-query.h"
+
+#include <algorithm>
+#include <cstring>
+#ifdef UNIX
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#include "libutil.h"
+#include "stringutil.h"
+
+xlog_file::xlog_file() : data(nullptr), size(0), mapped(false), buf()
+{
+}
+
+xlog_file::~xlog_file()
+{
+#ifdef UNIX
+    if (mapped)
+        munmap(const_cast<char *>(data), size);
+#endif
+}
+
+bool xlog_file::open(FILE *f)
+{
+#ifdef UNIX
+    struct stat st;
+    if (!fstat(fileno(f), &st) && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE,
+                         fileno(f), 0);
+        if (map != MAP_FAILED)
+        {
+            data = static_cast<const char *>(map);
+            size = st.st_size;
+            mapped = true;
+            return true;
+        }
+    }
+#endif
+
+    char chunk[65536];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        buf.insert(buf.end(), chunk, chunk + got);
+    if (ferror(f))
+        return false;
+
+    data = buf.data();
+    size = buf.size();
+    return true;
+}
+
+bool xlog_file::next_line(size_t &pos, xlog_line &line) const
+{
+    while (pos < size)
+    {
+        const char *start = data + pos;
+        const char *nl = static_cast<const char *>(
+            memchr(start, '\n', size - pos));
+        const size_t len = nl ? nl - start : size - pos;
+        pos += len + 1;
+
+        if (len && !(len == 1 && *start == '\r'))
+        {
+            line.start = start;
+            line.len = len;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Find a field's value in an xlog line, as xlog_fields would, without
+ * splitting the rest of the line up.
+ *
+ * @return whether the field was there.
+ */
+bool xlog_find_field(const xlog_line &line, const char *key, string &value)
+{
+    const size_t keylen = strlen(key);
+    const char *p = line.start;
+    const char *end = line.start + line.len;
+
+    while (p < end)
+    {
+        // Fields are separated by single colons; "::" is an escaped colon.
+        const char *field = p;
+        while (p < end && *p != ':')
+            ++p;
+        while (p + 1 < end && p[1] == ':')
+        {
+            p += 2;
+            while (p < end && *p != ':')
+                ++p;
+        }
+
+        if (p - field > (ptrdiff_t) keylen
+            && !memcmp(field, key, keylen) && field[keylen] == '=')
+        {
+            value = replace_all(string(field + keylen + 1, p), "::", ":");
+            return true;
+        }
+        ++p;
+    }
+    return false;
+}
+
+// YYYYMMDD to the first eight characters of an xlog date, whose months
+// count from 0.
+static bool _xlog_date(const string &date, string &xdate)
+{
+    if (date.length() != 8
+        || !all_of(date.begin(), date.end(),
+                   [](char c) { return isadigit(c); }))
+    {
+        return false;
+    }
+
+    const int month = atoi(date.substr(4, 2).c_str());
+    if (month < 1 || month > 12)
+        return false;
+
+    xdate = make_stringf("%s%02d%s", date.substr(0, 4).c_str(), month - 1,
+                         date.substr(6, 2).c_str());
+    return true;
+}
+
+bool xlog_query::parse(const string &spec, string &err)
+{
+    for (const string &term : split_string(",", spec))
+    {
+        const string::size_type eq = term.find('=');
+        if (eq == string::npos || !eq)
+        {
+            err = make_stringf("Bad score query term '%s'", term.c_str());
+            return false;
+        }
+
+        string key = trimmed_string(term.substr(0, eq));
+        const string value = trimmed_string(term.substr(eq + 1));
+
+        if (key == "since" || key == "until")
+        {
+            if (!_xlog_date(value, key == "since" ? since : until))
+            {
+                err = make_stringf("Bad date '%s' (use YYYYMMDD)",
+                                   value.c_str());
+                return false;
+            }
+        }
+        else if (key == "version" || key == "v")
+            version = value;
+        else
+        {
+            if (key == "species")
+                key = "race";
+            equal.emplace_back(key, value);
+        }
+    }
+    return true;
+}
+
+bool xlog_query::empty() const
+{
+    return equal.empty() && version.empty() && since.empty()
+           && until.empty();
+}
+
+bool xlog_query::matches(const xlog_line &line) const
+{
+    string value;
+    for (const auto &term : equal)
+    {
+        if (!xlog_find_field(line, term.first.c_str(), value)
+            || value != term.second)
+        {
+            return false;
+        }
+    }
+
+    if (!version.empty()
+        && (!xlog_find_field(line, "v", value)
+            || !starts_with(value, version)))
+    {
+        return false;
+    }
+
+    if (!since.empty() || !until.empty())
+    {
+        if (!xlog_find_field(line, "end", value) || value.length() < 8)
+            return false;
+        value.resize(8);
+        if ((!since.empty() && value < since)
+            || (!until.empty() && value > until))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+vector<xlog_line> xlog_query::select(const xlog_file &file, int limit) const
+{
+    vector<xlog_line> lines;
+    size_t pos = 0;
+    xlog_line line;
+    while ((limit <= 0 || (int) lines.size() < limit)
+           && file.next_line(pos, line))
+    {
+        if (matches(line))
+            lines.push_back(line);
+    }
+    return lines;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief Filtered queries over xlog files (score files and logfiles)
+ *        without parsing every entry.
+**/
+
+#pragma once
+
+#include <cstdio>
+
+// One line of an xlog file, without its newline. Points into the file's
+// buffer, so only valid while that is open.
+struct xlog_line
+{
+    const char *start;
+    size_t len;
+};
+
+// A whole xlog file, memory-mapped where possible and read in otherwise
+// (so pipes such as standard input work too).
+class xlog_file
+{
+public:
+    xlog_file();
+    ~xlog_file();
+    xlog_file(const xlog_file &) = delete;
+    xlog_file &operator = (const xlog_file &) = delete;
+
+    bool open(FILE *f);
+
+    // Split into lines on demand; blank lines are skipped.
+    bool next_line(size_t &pos, xlog_line &line) const;
+
+private:
+    const char *data;
+    size_t size;
+    bool mapped;
+    vector<char> buf;
+};
+
+bool xlog_find_field(const xlog_line &line, const char *key, string &value);
+
+/**
+ * A filter on xlog entries, such as "name=foo,race=Minotaur". Any field
+ * can be matched exactly; besides that:
+ *   species=  is another name for race=,
+ *   version=  (or v=) matches versions starting with the given one, so
+ *             version=0.2 matches 0.2.1,
+ *   since= and until= take a date as YYYYMMDD and match on the date the
+ *             game ended, inclusively.
+ */
+class xlog_query
+{
+public:
+    bool parse(const string &spec, string &err);
+    bool empty() const;
+    bool matches(const xlog_line &line) const;
+
+    // The first limit matching lines, in file order. All of them if
+    // limit <= 0.
+    vector<xlog_line> select(const xlog_file &file, int limit) const;
+
+private:
+    vector<pair<string, string>> equal;
+    string version;
+    string since, until; // in xlog's own date format, as far as the day
+};